@@ -1,31 +1,83 @@
 #include "buffer.hpp"
 #include "internal/buffer_context.hpp"
+#include <algorithm>
 #include <cstring>
 
+// Минимальная емкость строки, с которой начинается рост буффера
+#define BUFFER_MIN_CAPACITY 4096
+
+// Обновляет указатели на начало непрерывного окна чтения
+void update_read_pointers(buffer_ctx *ctx) {
+    for (std::size_t i = 0; i < ctx->rows_count; ++i) {
+        ctx->data[i] = ctx->storage[i] + ctx->head;
+    }
+}
+
+// Переносит данные строк в начало хранилища новой емкости
+void relocate_rows(buffer_ctx *ctx, std::size_t new_capacity) {
+    for (std::size_t i = 0; i < ctx->rows_count; ++i) {
+        if (new_capacity == ctx->capacity) {
+            memmove(ctx->storage[i], ctx->storage[i] + ctx->head, ctx->colums_count);
+            continue;
+        }
+
+        auto new_row = new uint8_t[new_capacity];
+        memcpy(new_row, ctx->storage[i] + ctx->head, ctx->colums_count);
+        delete[] ctx->storage[i];
+        ctx->storage[i] = new_row;
+    }
+
+    ctx->capacity = new_capacity;
+    ctx->head = 0;
+    update_read_pointers(ctx);
+}
+
+// Гарантирует наличие места под указанное количество столбцов после текущих данных.
+// Хранилище растет геометрически, а уплотнение выполняется только когда занятая часть
+// не больше половины емкости, поэтому каждый байт копируется амортизированно O(1) раз.
+void reserve_tail(buffer_ctx *ctx, std::size_t new_columns) {
+    std::size_t required = ctx->colums_count + new_columns;
+
+    if (ctx->head + required <= ctx->capacity) {
+        return;
+    }
+
+    if (required <= ctx->capacity / 2) {
+        relocate_rows(ctx, ctx->capacity);
+        return;
+    }
+
+    std::size_t new_capacity = std::max<std::size_t>(ctx->capacity, BUFFER_MIN_CAPACITY);
+
+    while (new_capacity < required * 2) {
+        new_capacity *= 2;
+    }
+
+    relocate_rows(ctx, new_capacity);
+}
+
 void buffer_allocate(void **ctx_ref, std::size_t rows_count) {
+    auto **storage = new uint8_t*[rows_count];
     auto **data = new uint8_t*[rows_count];
 
     for (std::size_t i = 0; i < rows_count; ++i) {
-        data[i] = new uint8_t[0];
+        storage[i] = new uint8_t[0];
+        data[i] = storage[i];
     }
 
-    *ctx_ref = new buffer_ctx{data, 0, rows_count};
+    *ctx_ref = new buffer_ctx{storage, data, 0, rows_count, 0, 0};
 }
 
 uint8_t **buffer_allocate_new_columns(void *ctx_ref, std::size_t new_columns) {
     auto casted_ctx = reinterpret_cast<buffer_ctx *>(ctx_ref);
     auto last_pointers = new uint8_t*[casted_ctx->rows_count];
-    std::size_t new_colums_count = new_columns + casted_ctx->colums_count;
+    reserve_tail(casted_ctx, new_columns);
 
     for (std::size_t i = 0; i < casted_ctx->rows_count; ++i) {
-        auto new_buffer = new uint8_t[new_colums_count];
-        memcpy(new_buffer, casted_ctx->data[i], casted_ctx->colums_count);
-        delete[] casted_ctx->data[i];
-        casted_ctx->data[i] = new_buffer;
         last_pointers[i] = casted_ctx->data[i] + casted_ctx->colums_count;
     }
 
-    casted_ctx->colums_count = new_colums_count;
+    casted_ctx->colums_count += new_columns;
     return last_pointers;
 }
 
@@ -35,15 +87,12 @@ uint8_t **buffer_get_pointer(void *ctx_ref) {
 
 void buffer_delete_from_start(void *ctx_ref, std::size_t count) {
     auto casted_ctx = reinterpret_cast<buffer_ctx *>(ctx_ref);
-
-    for (std::size_t i = 0; i < casted_ctx->rows_count; ++i) {
-        auto new_buffer = new uint8_t[casted_ctx->colums_count - count];
-        memcpy(new_buffer, &casted_ctx->data[i][count], casted_ctx->colums_count - count);
-        delete[] casted_ctx->data[i];
-        casted_ctx->data[i] = new_buffer;
-    }
-
+    count = std::min(count, casted_ctx->colums_count);
     casted_ctx->colums_count -= count;
+
+    // Пустой буффер можно начинать заполнять с начала без копирования
+    casted_ctx->head = casted_ctx->colums_count == 0 ? 0 : casted_ctx->head + count;
+    update_read_pointers(casted_ctx);
 }
 
 std::size_t buffer_get_colums_count(void *ctx_ref) {
@@ -54,9 +103,10 @@ void buffer_free(void **ctx_ref) {
     auto casted_ctx = reinterpret_cast<buffer_ctx *>(*ctx_ref);
 
     for (std::size_t i = 0; i < casted_ctx->rows_count; ++i) {
-        delete[] casted_ctx->data[i];
+        delete[] casted_ctx->storage[i];
     }
 
+    delete[] casted_ctx->storage;
     delete[] casted_ctx->data;
     delete casted_ctx;
     *ctx_ref = nullptr;
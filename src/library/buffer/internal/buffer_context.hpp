@@ -3,10 +3,16 @@
 
 #include <cstdint>
 
+// Каждая строка хранится в собственном массиве размером capacity.
+// Данные занимают диапазон [head, head + colums_count), поэтому удаление с начала
+// сводится к сдвигу head, а окно чтения всегда остается непрерывным.
 struct buffer_ctx {
+  uint8_t** storage = nullptr;
   uint8_t** data = nullptr;
   std::size_t colums_count = 0;
   std::size_t rows_count = 0;
+  std::size_t head = 0;
+  std::size_t capacity = 0;
 };
 
 #endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_BUFFER_BUFFER_CONTEXT_HPP_
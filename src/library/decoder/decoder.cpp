@@ -1,16 +1,40 @@
 #include <map>
+#include <algorithm>
 #include <deque>
 #include <vector>
 #include <iostream>
 #include <functional>
+#include <thread>
+#include <atomic>
+#include <memory>
 
 extern "C" {
 #include <libavutil/channel_layout.h>
+#include <libavutil/intreadwrite.h>
 }
 
 #include "decoder.hpp"
 #include "decoder_context.hpp"
 #include "decoder_errors.hpp"
+#include "decoder_pool.hpp"
+#include "decoder_pool_context.hpp"
+#include "decoder_packet_queue.hpp"
+#include "decoder_read_ahead.hpp"
+#include "../seek_index/seek_index.hpp"
+#include "../io/io.hpp"
+#include "../probe_cache/probe_cache.hpp"
+#include "../scheduler/scheduler.hpp"
+
+// Минимальная длина фрагмента в микросекундах, с которой включается автоматическая многопоточность
+#define DECODER_AUTO_THREADS_MIN_LENGTH (60 * AV_TIME_BASE)
+
+// Максимальное количество потоков при автоматическом выборе
+#define DECODER_AUTO_THREADS_MAX_COUNT 8
+
+// Проверяет, что список запрошенных типов стримов можно декодировать
+bool is_streams_types_supported(std::unordered_set<AVMediaType> &streams_types) {
+    return !streams_types.empty() && !streams_types.contains(AVMediaType::AVMEDIA_TYPE_UNKNOWN);
+}
 
 // Проверяет наличие всех типов стримов
 bool is_all_streams_found(std::unordered_set<AVMediaType> &streams_types,
@@ -39,210 +63,1400 @@ bool is_all_streams_found(std::unordered_set<AVMediaType> &streams_types,
                        });
 }
 
-// Удаляет контексты стримов
-void free_stream_contexts(std::vector<decoder_stream_ctx *> *contexts) {
+// Освобождает буффер преобразованных семплов
+void free_converted_data(decoder_stream_ctx *stream_ctx) {
+    if (stream_ctx->converted_data != nullptr) {
+        av_freep(&stream_ctx->converted_data[0]);
+        av_freep(&stream_ctx->converted_data);
+    }
+
+    stream_ctx->converted_capacity = 0;
+}
+
+// Удаляет контексты стримов. Открытые кодеки при наличии пула возвращаются в него.
+void free_stream_contexts(std::vector<decoder_stream_ctx *> *contexts, decoder_pool_ctx *pool = nullptr) {
     for (const auto &item : (*contexts)) {
-        avcodec_free_context(&item->context);
+        if (item == nullptr) {
+            continue;
+        }
+
+        if (pool != nullptr && item->params != nullptr) {
+            decoder_pool_put_codec(pool, decoder_pool_codec{item->context,
+                                                             item->params,
+                                                             item->threads_count,
+                                                             item->thread_type});
+        } else {
+            avcodec_free_context(&item->context);
+            avcodec_parameters_free(&item->params);
+        }
+
+        swr_free(&item->converter);
+        free_converted_data(item);
         delete item;
     }
 
     delete contexts;
 }
 
+// Выбирает количество потоков декодирования
+int select_threads_count(const decoder_options &options, int64_t decode_length) {
+    switch (options.threads_policy) {
+        case DECODER_THREADS_FIXED:return std::max(options.threads_count, 1);
+        case DECODER_THREADS_AUTO: {
+            // На коротких фрагментах запуск потоков стоит дороже, чем выигрыш от них
+            if (decode_length != AV_NOPTS_VALUE && decode_length < DECODER_AUTO_THREADS_MIN_LENGTH) {
+                return 1;
+            }
+
+            auto cores_count = static_cast<int>(std::thread::hardware_concurrency());
+            return std::clamp(cores_count, 1, DECODER_AUTO_THREADS_MAX_COUNT);
+        }
+        default:return 1;
+    }
+}
+
+// Выбирает многопоточность декодера с учетом того, что поддерживает кодек
+void select_decoder_threads(const AVCodec *decoder,
+                            const decoder_options &options,
+                            int64_t decode_length,
+                            int *threads_count_ref,
+                            int *thread_type_ref) {
+    int threads_count = select_threads_count(options, decode_length);
+    int thread_type = 0;
+
+    if (decoder->capabilities & AV_CODEC_CAP_FRAME_THREADS) {
+        thread_type |= options.thread_type & FF_THREAD_FRAME;
+    }
+
+    if (decoder->capabilities & AV_CODEC_CAP_SLICE_THREADS) {
+        thread_type |= options.thread_type & FF_THREAD_SLICE;
+    }
+
+    if (threads_count <= 1 || thread_type == 0) {
+        *threads_count_ref = 1;
+        *thread_type_ref = 0;
+        return;
+    }
+
+    *threads_count_ref = threads_count;
+    *thread_type_ref = thread_type;
+}
+
+// Открывает новый кодек для потока
+AVCodecContext *open_decoder_context(const AVCodec *decoder,
+                                     AVStream *stream,
+                                     int threads_count,
+                                     int thread_type) {
+    AVCodecContext *decoder_context = avcodec_alloc_context3(decoder);
+
+    if (decoder_context == nullptr) {
+        return nullptr;
+    }
+
+    decoder_context->pkt_timebase = stream->time_base;
+
+    if (avcodec_parameters_to_context(decoder_context, stream->codecpar) < 0) {
+        avcodec_free_context(&decoder_context);
+        return nullptr;
+    }
+
+    decoder_context->thread_count = threads_count;
+
+    if (thread_type != 0) {
+        decoder_context->thread_type = thread_type;
+    }
+
+    if (avcodec_open2(decoder_context, decoder, nullptr) < 0) {
+        avcodec_free_context(&decoder_context);
+        return nullptr;
+    }
+
+    return decoder_context;
+}
+
+// Определяет формат выдаваемых семплов потока и при необходимости создает преобразователь в него
+bool init_stream_output(decoder_stream_ctx *stream_ctx, const decoder_options &options) {
+    AVCodecContext *context = stream_ctx->context;
+    uint64_t channel_layout = context->channel_layout != 0
+                              ? context->channel_layout
+                              : av_get_default_channel_layout(context->channels);
+
+    stream_ctx->output_sample_format = context->sample_fmt;
+    stream_ctx->output_sample_rate = context->sample_rate;
+    stream_ctx->output_channel_layout = channel_layout;
+    stream_ctx->output_channels_count = context->channels;
+
+    if (context->codec_type != AVMEDIA_TYPE_AUDIO) {
+        return true;
+    }
+
+    if (options.output_sample_format != AV_SAMPLE_FMT_NONE) {
+        stream_ctx->output_sample_format = options.output_sample_format;
+    }
+
+    if (options.output_sample_rate > 0) {
+        stream_ctx->output_sample_rate = options.output_sample_rate;
+    }
+
+    if (options.output_channel_layout != 0) {
+        stream_ctx->output_channel_layout = options.output_channel_layout;
+        stream_ctx->output_channels_count = av_get_channel_layout_nb_channels(options.output_channel_layout);
+    }
+
+    if (stream_ctx->output_sample_format == context->sample_fmt
+        && stream_ctx->output_sample_rate == context->sample_rate
+        && stream_ctx->output_channel_layout == channel_layout) {
+        return true;
+    }
+
+    stream_ctx->converter = swr_alloc_set_opts(nullptr,
+                                               static_cast<int64_t>(stream_ctx->output_channel_layout),
+                                               stream_ctx->output_sample_format,
+                                               stream_ctx->output_sample_rate,
+                                               static_cast<int64_t>(channel_layout),
+                                               context->sample_fmt,
+                                               context->sample_rate,
+                                               0,
+                                               nullptr);
+
+    return stream_ctx->converter != nullptr && swr_init(stream_ctx->converter) >= 0;
+}
+
+// Выбирает длительность пре-ролла кодека в микросекундах или -1, если для кодека она неизвестна
+int64_t get_stream_preroll(const AVCodecParameters *params) {
+    int64_t samples_count;
+
+    switch (params->codec_id) {
+        // Кодеки без межфреймовой зависимости
+        case AV_CODEC_ID_FLAC:
+        case AV_CODEC_ID_PCM_S16LE:
+        case AV_CODEC_ID_PCM_S16BE:
+        case AV_CODEC_ID_PCM_S24LE:
+        case AV_CODEC_ID_PCM_S32LE:
+        case AV_CODEC_ID_PCM_F32LE:
+        case AV_CODEC_ID_PCM_U8:samples_count = 0;
+            break;
+        // Opus сам сообщает нужный пре-ролл, по спецификации он не меньше 80 мс
+        case AV_CODEC_ID_OPUS:samples_count = std::max<int64_t>(params->seek_preroll, 3840);
+            break;
+        // Перекрытие MDCT и задержка SBR
+        case AV_CODEC_ID_AAC:samples_count = 2 * 1024;
+            break;
+        // Битовый резервуар может ссылаться на несколько предыдущих фреймов
+        case AV_CODEC_ID_MP3:samples_count = 3 * 1152;
+            break;
+        // Перекрытие с предыдущим блоком
+        case AV_CODEC_ID_VORBIS:samples_count = 2 * 2048;
+            break;
+        default:return -1;
+    }
+
+    if (params->sample_rate <= 0) {
+        return -1;
+    }
+
+    return av_rescale(samples_count, AV_TIME_BASE, params->sample_rate);
+}
+
 // Инициализирует декодеры
 bool init_decoders(AVStream **streams,
                    unsigned int streams_count,
                    std::unordered_set<AVMediaType> &streams_types,
+                   const decoder_options &options,
+                   int64_t decode_length,
+                   decoder_pool_ctx *pool,
                    std::vector<decoder_stream_ctx *> **contexts_ref) {
     auto contexts = new std::vector<decoder_stream_ctx *>(streams_count, nullptr);
 
     for (unsigned int i = 0; i < streams_count; ++i) {
         AVStream *stream = streams[i];
 
-        if (!streams_types.contains(stream->codecpar->codec_type)) {
+        if (!streams_types.contains(stream->codecpar->codec_type)
+            || (options.stream_index >= 0 && (int) i != options.stream_index)) {
             continue;
         }
 
         const AVCodec *decoder = avcodec_find_decoder(stream->codecpar->codec_id);
-        AVCodecContext *decoder_context = avcodec_alloc_context3(decoder);
 
-        if (decoder_context == nullptr) {
-            free_stream_contexts(contexts);
+        // Декодер кодека мог не попасть в сборку FFmpeg
+        if (decoder == nullptr) {
+            free_stream_contexts(contexts, pool);
             return false;
         }
 
-        decoder_context->pkt_timebase = stream->time_base;
+        int threads_count;
+        int thread_type;
+
+        select_decoder_threads(decoder, options, decode_length, &threads_count, &thread_type);
+
+        // Кодек, открытый с теми же параметрами, берем из пула вместо повторного открытия
+        decoder_pool_codec pooled_codec;
+
+        if (pool != nullptr
+            && decoder_pool_take_codec(pool, stream->codecpar, threads_count, thread_type, &pooled_codec)) {
+            pooled_codec.context->pkt_timebase = stream->time_base;
+            (*contexts)[i] = new decoder_stream_ctx{decoder, pooled_codec.context, 0, 0, (int) i, pooled_codec.params};
+
+            // Opus пропускает pre-skip только после открытия, сброс кодека его не восстанавливает
+            if (pooled_codec.context->codec_id == AV_CODEC_ID_OPUS) {
+                (*contexts)[i]->pending_skip_samples = pooled_codec.context->delay;
+            }
+        } else {
+            AVCodecContext *decoder_context = open_decoder_context(decoder, stream, threads_count, thread_type);
+
+            if (decoder_context == nullptr) {
+                free_stream_contexts(contexts, pool);
+                return false;
+            }
+
+            AVCodecParameters *params = nullptr;
+
+            if (pool != nullptr) {
+                decoder_pool_count_opened_codec(pool);
+                params = avcodec_parameters_alloc();
+                avcodec_parameters_copy(params, stream->codecpar);
+            }
+
+            (*contexts)[i] = new decoder_stream_ctx{decoder, decoder_context, 0, 0, (int) i, params};
+        }
+
+        (*contexts)[i]->threads_count = threads_count;
+        (*contexts)[i]->thread_type = thread_type;
 
-        if (avcodec_parameters_to_context(decoder_context, stream->codecpar) < 0
-            || avcodec_open2(decoder_context, decoder, nullptr) < 0) {
-            free_stream_contexts(contexts);
+        if (!init_stream_output((*contexts)[i], options)) {
+            free_stream_contexts(contexts, pool);
             return false;
         }
 
-        (*contexts)[i] = new decoder_stream_ctx{decoder, decoder_context, 0, 0};
+        (*contexts)[i]->preroll = get_stream_preroll(stream->codecpar);
     }
 
     *contexts_ref = contexts;
     return true;
 }
 
-int decoder_init(void **ctx_ref,
-                 const char *path,
-                 int64_t start_moment,
-                 int64_t end_moment,
-                 std::unordered_set<AVMediaType> &streams_types) {
-    if (streams_types.empty() || streams_types.contains(AVMediaType::AVMEDIA_TYPE_UNKNOWN)) {
+// Перематывает вход к началу нарезки, по возможности через индекс перемотки
+bool seek_to_start_moment(AVFormatContext *format_ctx,
+                          const char *path,
+                          int64_t start_moment,
+                          const decoder_options &options) {
+    if (options.seek_index_path != nullptr && path != nullptr) {
+        void *seek_index_ctx;
+
+        if (seek_index_open(&seek_index_ctx, path, options.seek_index_path) == 0) {
+            int seek_result = seek_index_seek(seek_index_ctx, format_ctx, start_moment * 1000);
+            seek_index_free(&seek_index_ctx);
+
+            if (seek_result == 0) {
+                return true;
+            }
+        }
+    }
+
+    return av_seek_frame(format_ctx, -1, start_moment * 1000, 0) >= 0;
+}
+
+// Закрывает вход вместе с пользовательским AVIOContext, если он был передан
+void close_input(AVFormatContext **format_ctx_ref, AVIOContext **io_ctx_ref) {
+    avformat_close_input(format_ctx_ref);
+    io_free(io_ctx_ref);
+}
+
+// Открывает вход и инициализирует поверх него декодер.
+// Пользовательский AVIOContext передается во владение декодера и освобождается при ошибке.
+int init_from_input(void **ctx_ref,
+                    const char *path,
+                    AVIOContext *io_ctx,
+                    int64_t start_moment,
+                    int64_t end_moment,
+                    std::unordered_set<AVMediaType> &streams_types,
+                    const decoder_options &options,
+                    decoder_pool_ctx *pool = nullptr) {
+    if (!is_streams_types_supported(streams_types)) {
+        io_free(&io_ctx);
         return DECODER_UNSUPPORTED_MEDIA_TYPE_ERROR;
     }
 
     AVFormatContext *format_ctx = avformat_alloc_context();
+    format_ctx->interrupt_callback = options.interrupt_callback;
+
+    if (io_ctx != nullptr) {
+        format_ctx->pb = io_ctx;
+        format_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+    }
 
     if (avformat_open_input(&format_ctx, path, nullptr, nullptr) < 0) {
         avformat_free_context(format_ctx);
+        io_free(&io_ctx);
         return DECODER_INPUT_OPENING_ERROR;
     }
 
-    if (avformat_find_stream_info(format_ctx, nullptr) < 0) {
-        avformat_close_input(&format_ctx);
-        return DECODER_STREAM_INFO_SEARCHING_ERROR;
+    // Повторно открываемые файлы не анализируем: параметры потоков берутся из кэша
+    if (!probe_cache_restore(path, format_ctx)) {
+        if (avformat_find_stream_info(format_ctx, nullptr) < 0) {
+            close_input(&format_ctx, &io_ctx);
+            return DECODER_STREAM_INFO_SEARCHING_ERROR;
+        }
+
+        if (path != nullptr) {
+            probe_cache_store(path, format_ctx);
+        }
     }
 
-    if (!is_all_streams_found(streams_types, format_ctx->streams, format_ctx->nb_streams)) {
-        avformat_close_input(&format_ctx);
+    if (!is_all_streams_found(streams_types, format_ctx->streams, format_ctx->nb_streams)
+        || (options.stream_index >= 0
+            && (options.stream_index >= (int) format_ctx->nb_streams
+                || !streams_types.contains(format_ctx->streams[options.stream_index]->codecpar->codec_type)))) {
+        close_input(&format_ctx, &io_ctx);
         return DECODER_NOT_ALL_CODECS_FOUND_ERROR;
     }
 
     std::vector<decoder_stream_ctx *> *stream_contexts;
+    int64_t decode_length = end_moment != 0 ? (end_moment - start_moment) * 1000 : AV_NOPTS_VALUE;
+
+    if (decode_length == AV_NOPTS_VALUE && format_ctx->duration != AV_NOPTS_VALUE) {
+        decode_length = format_ctx->duration - start_moment * 1000;
+    }
 
     if (!init_decoders(format_ctx->streams,
                        format_ctx->nb_streams,
                        streams_types,
+                       options,
+                       decode_length,
+                       pool,
                        &stream_contexts)) {
-        avformat_close_input(&format_ctx);
+        close_input(&format_ctx, &io_ctx);
         return DECODER_NOT_ALL_CODECS_OPENED_ERROR;
     }
 
-    if (start_moment > 0) {
-        if (av_seek_frame(format_ctx, -1, start_moment * 1000, 0) < 0) {
-            free_stream_contexts(stream_contexts);
-            avformat_close_input(&format_ctx);
+    // Пакеты невыбранных потоков демуксер может отбрасывать, не разбирая их
+    for (unsigned int i = 0; i < format_ctx->nb_streams; ++i) {
+        if ((*stream_contexts)[i] == nullptr) {
+            format_ctx->streams[i]->discard = AVDISCARD_ALL;
+        }
+    }
+
+    // Вход без перемотки не перематывается, начало нарезки отсчитывается по фреймам
+    bool is_seekable = format_ctx->pb == nullptr || (format_ctx->pb->seekable & AVIO_SEEKABLE_NORMAL);
+
+    if (start_moment > 0 && is_seekable) {
+        if (!seek_to_start_moment(format_ctx, path, start_moment, options)) {
+            free_stream_contexts(stream_contexts, pool);
+            close_input(&format_ctx, &io_ctx);
             return DECODER_UNEXPECTED_ERROR;
         }
     }
 
-    *ctx_ref = new decoder_ctx{
-        av_frame_alloc(),
-        av_packet_alloc(),
-        format_ctx,
-        stream_contexts,
-        new std::unordered_set<int>(),
-        end_moment != 0 ? (end_moment - start_moment) * 1000 : -1
-    };
+    decoder_ctx *ctx = pool != nullptr ? decoder_pool_take_shell(pool) : nullptr;
 
+    if (ctx == nullptr) {
+        ctx = new decoder_ctx{av_frame_alloc(), av_packet_alloc()};
+        ctx->decoded_channels = new std::unordered_set<int>();
+    }
+
+    ctx->format_ctx = format_ctx;
+    ctx->stream_contexts = stream_contexts;
+    ctx->duration = end_moment != 0 ? (end_moment - start_moment) * 1000 : -1;
+    ctx->range_trimmed = start_moment > 0 || end_moment != 0;
+    ctx->selected_streams_count = static_cast<std::size_t>(std::count_if(stream_contexts->cbegin(),
+                                                                         stream_contexts->cend(),
+                                                                         [](decoder_stream_ctx *stream_ctx) {
+                                                                           return stream_ctx != nullptr;
+                                                                         }));
+    ctx->io_ctx = io_ctx;
+    ctx->frame_pending = false;
+    ctx->frame_offset = 0;
+    ctx->frame_pts = 0;
+    ctx->pool = pool;
+    ctx->read_ahead = nullptr;
+    ctx->start_time = (options.skip_preroll_packets || !is_seekable) && start_moment > 0
+                      ? start_moment * 1000
+                      : AV_NOPTS_VALUE;
+    ctx->skipped_packets_count = 0;
+
+    if (options.read_ahead_packets > 0) {
+        decoder_read_ahead_start(&ctx->read_ahead, format_ctx, options.read_ahead_packets);
+    }
+
+    *ctx_ref = ctx;
     return 0;
 }
 
-int decoder_decode(void *ctx_ref,
-                   const std::function<bool(const uint8_t **, size_t, int64_t)> &handle_frame) {
-    auto *casted_ctx = static_cast<decoder_ctx *>(ctx_ref);
-    int read_frame_result = av_read_frame(casted_ctx->format_ctx, casted_ctx->packet);
+int decoder_init(void **ctx_ref,
+                 const char *path,
+                 int64_t start_moment,
+                 int64_t end_moment,
+                 std::unordered_set<AVMediaType> &streams_types,
+                 const decoder_options &options) {
+    AVIOContext *io_ctx = nullptr;
 
-    if (read_frame_result == AVERROR_EOF) {
+    if (options.input_mode == DECODER_INPUT_MMAP
+        && is_streams_types_supported(streams_types)
+        && io_open_mapped_file_input(&io_ctx, path) < 0) {
+        return DECODER_INPUT_OPENING_ERROR;
+    }
+
+    return init_from_input(ctx_ref, path, io_ctx, start_moment, end_moment, streams_types, options);
+}
+
+int decoder_init_from_memory(void **ctx_ref,
+                             const uint8_t *data,
+                             size_t size,
+                             int64_t start_moment,
+                             int64_t end_moment,
+                             std::unordered_set<AVMediaType> &streams_types,
+                             const decoder_options &options) {
+    AVIOContext *io_ctx;
+
+    if (io_open_memory_input(&io_ctx, data, size) < 0) {
+        return DECODER_INPUT_OPENING_ERROR;
+    }
+
+    return init_from_input(ctx_ref, nullptr, io_ctx, start_moment, end_moment, streams_types, options);
+}
+
+int decoder_init_from_fd(void **ctx_ref,
+                         int fd,
+                         int64_t start_moment,
+                         int64_t end_moment,
+                         std::unordered_set<AVMediaType> &streams_types,
+                         const decoder_options &options) {
+    AVIOContext *io_ctx;
+
+    if (io_open_fd_input(&io_ctx, fd) < 0) {
+        return DECODER_INPUT_OPENING_ERROR;
+    }
+
+    return init_from_input(ctx_ref, nullptr, io_ctx, start_moment, end_moment, streams_types, options);
+}
+
+int decoder_pool_acquire(void *pool_ref,
+                         void **ctx_ref,
+                         const char *path,
+                         int64_t start_moment,
+                         int64_t end_moment,
+                         std::unordered_set<AVMediaType> &streams_types,
+                         const decoder_options &options) {
+    AVIOContext *io_ctx = nullptr;
+
+    if (options.input_mode == DECODER_INPUT_MMAP
+        && is_streams_types_supported(streams_types)
+        && io_open_mapped_file_input(&io_ctx, path) < 0) {
+        return DECODER_INPUT_OPENING_ERROR;
+    }
+
+    return init_from_input(ctx_ref,
+                           path,
+                           io_ctx,
+                           start_moment,
+                           end_moment,
+                           streams_types,
+                           options,
+                           static_cast<decoder_pool_ctx *>(pool_ref));
+}
+
+// Читает следующий пакет входа, при включенном упреждающем чтении забирая его из очереди
+int read_next_packet(decoder_ctx *ctx) {
+    return ctx->read_ahead != nullptr
+           ? decoder_read_ahead_read(ctx->read_ahead, ctx->packet)
+           : av_read_frame(ctx->format_ctx, ctx->packet);
+}
+
+// Проверяет, что пакет заканчивается раньше пре-ролла перед началом нарезки и его можно не декодировать
+bool is_packet_before_preroll(decoder_ctx *ctx, decoder_stream_ctx *stream_ctx, AVPacket *packet) {
+    if (ctx->start_time == AV_NOPTS_VALUE || stream_ctx->preroll < 0 || packet->pts == AV_NOPTS_VALUE) {
+        return false;
+    }
+
+    int64_t packet_end = av_rescale_q(packet->pts + packet->duration,
+                                      stream_ctx->context->pkt_timebase,
+                                      AV_TIME_BASE_Q);
+
+    return packet_end < ctx->start_time - stream_ctx->preroll;
+}
+
+// Проверяет, что фрейм целиком лежит до начала нарезки и выдавать его не нужно
+bool is_frame_before_start(decoder_ctx *ctx, AVFrame *frame, int64_t pts) {
+    if (ctx->start_time == AV_NOPTS_VALUE || frame->sample_rate <= 0) {
+        return false;
+    }
+
+    return pts + av_rescale(frame->nb_samples, AV_TIME_BASE, frame->sample_rate) <= ctx->start_time;
+}
+
+// Добавляет к первому пакету взятого из пула кодека количество семплов, пропускаемых в начале
+bool apply_pending_skip_samples(decoder_stream_ctx *stream_ctx, AVPacket *packet) {
+    if (stream_ctx->pending_skip_samples < 0) {
+        return true;
+    }
+
+    int64_t skip_samples = stream_ctx->pending_skip_samples;
+    stream_ctx->pending_skip_samples = -1;
+
+    if (skip_samples == 0 || av_packet_get_side_data(packet, AV_PKT_DATA_SKIP_SAMPLES, nullptr) != nullptr) {
+        return true;
+    }
+
+    uint8_t *side_data = av_packet_new_side_data(packet, AV_PKT_DATA_SKIP_SAMPLES, 10);
+
+    if (side_data == nullptr) {
+        return false;
+    }
+
+    AV_WL32(side_data, skip_samples);
+    AV_WL32(side_data + 4, 0);
+    side_data[8] = 0;
+    side_data[9] = 0;
+    return true;
+}
+
+// Отправляет пустой пакет в кодек очередного не дошедшего до конца нарезки потока, чтобы получить
+// задержанные кодеком фреймы. При многопоточном декодировании по фреймам их столько же, сколько потоков.
+int flush_next_codec(decoder_ctx *ctx,
+                     int stream_filter,
+                     decoder_stream_ctx **stream_ctx_ref,
+                     int *stream_index_ref) {
+    for (size_t i = 0; i < ctx->stream_contexts->size(); ++i) {
+        decoder_stream_ctx *stream_ctx = (*ctx->stream_contexts)[i];
+
+        if (stream_ctx == nullptr
+            || stream_ctx->codec_flushed
+            || ctx->decoded_channels->contains((int) i)
+            || (stream_filter >= 0 && (int) i != stream_filter)) {
+            continue;
+        }
+
+        stream_ctx->codec_flushed = true;
+
+        if (avcodec_send_packet(stream_ctx->context, nullptr) < 0) {
+            return DECODER_UNEXPECTED_ERROR;
+        }
+
+        *stream_ctx_ref = stream_ctx;
+        *stream_index_ref = (int) i;
+        return 0;
+    }
+
+    return DECODER_END_OF_STREAM_ERROR;
+}
+
+// Читает следующий пакет и отправляет его в декодер соответствующего потока.
+// Если пакет пропущен, то в stream_ctx_ref записывается nullptr.
+int send_next_packet(decoder_ctx *ctx,
+                     int stream_filter,
+                     decoder_stream_ctx **stream_ctx_ref,
+                     int *stream_index_ref) {
+    *stream_ctx_ref = nullptr;
+
+    // Как только все выбранные потоки дошли до конца нарезки, дальше файл не читаем
+    if (ctx->decoded_channels->size() >= ctx->selected_streams_count) {
         return DECODER_END_OF_STREAM_ERROR;
+    }
+
+    int read_frame_result = read_next_packet(ctx);
+
+    if (read_frame_result == AVERROR_EOF) {
+        return flush_next_codec(ctx, stream_filter, stream_ctx_ref, stream_index_ref);
     } else if (read_frame_result < 0) {
         return DECODER_UNEXPECTED_ERROR;
     }
 
-    if (casted_ctx->decoded_channels->size() >= casted_ctx->stream_contexts->size()) {
-        av_packet_unref(casted_ctx->packet);
-        return DECODER_END_OF_STREAM_ERROR;
-    } else if (casted_ctx->decoded_channels->contains(casted_ctx->packet->stream_index)) {
-        av_packet_unref(casted_ctx->packet);
+    int stream_index = ctx->packet->stream_index;
+
+    if (ctx->decoded_channels->contains(stream_index)
+        || (stream_filter >= 0 && stream_index != stream_filter)) {
+        av_packet_unref(ctx->packet);
         return 0;
     }
 
-    decoder_stream_ctx
-        *stream_ctx = (*casted_ctx->stream_contexts)[casted_ctx->packet->stream_index];
+    decoder_stream_ctx *stream_ctx = (*ctx->stream_contexts)[stream_index];
 
     if (stream_ctx == nullptr) {
-        av_packet_unref(casted_ctx->packet);
+        av_packet_unref(ctx->packet);
         return 0;
-    } else if (avcodec_send_packet(stream_ctx->context, casted_ctx->packet) < 0) {
-        av_packet_unref(casted_ctx->packet);
+    } else if (is_packet_before_preroll(ctx, stream_ctx, ctx->packet)) {
+        ctx->skipped_packets_count++;
+        av_packet_unref(ctx->packet);
+        return 0;
+    } else if (!apply_pending_skip_samples(stream_ctx, ctx->packet)
+               || avcodec_send_packet(stream_ctx->context, ctx->packet) < 0) {
+        av_packet_unref(ctx->packet);
         return DECODER_UNEXPECTED_ERROR;
     }
 
-    av_packet_unref(casted_ctx->packet);
+    av_packet_unref(ctx->packet);
+    *stream_ctx_ref = stream_ctx;
+    *stream_index_ref = stream_index;
+    return 0;
+}
+
+// Сдвигает время потока от начала нарезки до указанного момента
+void update_stream_time(decoder_stream_ctx *stream_ctx, int64_t pts) {
+    if (stream_ctx->prev_pts != 0) {
+        stream_ctx->current_time += pts - stream_ctx->prev_pts;
+    }
+
+    stream_ctx->prev_pts = pts;
+}
+
+// Учитывает фрейм в нарезке. Возвращает false, если фрейм лежит за ее концом.
+bool is_frame_in_range(decoder_ctx *ctx, decoder_stream_ctx *stream_ctx, AVFrame *frame, int64_t pts) {
+    if (ctx->duration == -1) {
+        return true;
+    }
+
+    if (!(frame->flags & AV_FRAME_FLAG_DISCARD)) {
+        update_stream_time(stream_ctx, pts);
+    }
+
+    return stream_ctx->current_time <= ctx->duration;
+}
+
+// Учитывает сжатый пакет в нарезке так же, как декодированный из него фрейм.
+// Возвращает false, если пакет лежит за концом нарезки.
+bool is_packet_in_range(decoder_ctx *ctx, decoder_stream_ctx *stream_ctx, int64_t pts) {
+    if (ctx->duration == -1) {
+        return true;
+    }
+
+    update_stream_time(stream_ctx, pts);
+    return stream_ctx->current_time <= ctx->duration;
+}
+
+// Выдает размер плоскости с указанным количеством выдаваемых семплов в байтах
+size_t get_output_bytes_count(decoder_stream_ctx *stream_ctx, int samples_count) {
+    size_t bytes_count = samples_count * av_get_bytes_per_sample(stream_ctx->output_sample_format);
+
+    if (!av_sample_fmt_is_planar(stream_ctx->output_sample_format)) {
+        bytes_count *= stream_ctx->output_channels_count;
+    }
+
+    return bytes_count;
+}
+
+// Выделяет буффер преобразованных семплов, вмещающий указанное количество семплов
+bool reserve_converted_data(decoder_stream_ctx *stream_ctx, int samples_count) {
+    if (samples_count <= stream_ctx->converted_capacity) {
+        return true;
+    }
+
+    free_converted_data(stream_ctx);
+
+    if (av_samples_alloc_array_and_samples(&stream_ctx->converted_data,
+                                           nullptr,
+                                           stream_ctx->output_channels_count,
+                                           samples_count,
+                                           stream_ctx->output_sample_format,
+                                           0) < 0) {
+        return false;
+    }
+
+    stream_ctx->converted_capacity = samples_count;
+    return true;
+}
+
+// Запоминает конец преобразованного фрейма, от которого отсчитывается время оставшихся в преобразователе семплов
+void update_converted_end_pts(decoder_stream_ctx *stream_ctx, AVFrame *frame) {
+    stream_ctx->converted_end_pts = av_rescale_q(frame->pts, stream_ctx->context->pkt_timebase, AV_TIME_BASE_Q)
+        + av_rescale(frame->nb_samples, AV_TIME_BASE, stream_ctx->context->sample_rate);
+}
+
+// Приводит аудио-фрейм к формату вывода потока в том же проходе, что и декодирование.
+// Без преобразования выдает плоскости самого фрейма. Возвращает количество семплов.
+int convert_frame(decoder_stream_ctx *stream_ctx, AVFrame *frame, uint8_t ***data_ref) {
+    if (stream_ctx->converter == nullptr) {
+        *data_ref = frame->extended_data;
+        return frame->nb_samples;
+    }
+
+    if (!reserve_converted_data(stream_ctx, swr_get_out_samples(stream_ctx->converter, frame->nb_samples))) {
+        return DECODER_UNEXPECTED_ERROR;
+    }
+
+    int samples_count = swr_convert(stream_ctx->converter,
+                                    stream_ctx->converted_data,
+                                    stream_ctx->converted_capacity,
+                                    const_cast<const uint8_t **>(frame->extended_data),
+                                    frame->nb_samples);
+
+    if (samples_count < 0) {
+        return DECODER_UNEXPECTED_ERROR;
+    }
+
+    update_converted_end_pts(stream_ctx, frame);
+    *data_ref = stream_ctx->converted_data;
+    return samples_count;
+}
+
+// Забирает семплы, задержанные преобразователем после последнего фрейма нарезки. При смене частоты
+// дискретизации без этого теряется конец записи. Возвращает количество семплов, хвост выдается один раз.
+int drain_converter(decoder_stream_ctx *stream_ctx, uint8_t ***data_ref, int64_t *pts) {
+    if (stream_ctx->converter == nullptr || stream_ctx->converter_drained) {
+        return 0;
+    }
+
+    stream_ctx->converter_drained = true;
+    *pts = stream_ctx->converted_end_pts - swr_get_delay(stream_ctx->converter, AV_TIME_BASE);
+
+    if (!reserve_converted_data(stream_ctx, swr_get_out_samples(stream_ctx->converter, 0))) {
+        return DECODER_UNEXPECTED_ERROR;
+    }
+
+    int samples_count = swr_convert(stream_ctx->converter,
+                                    stream_ctx->converted_data,
+                                    stream_ctx->converted_capacity,
+                                    nullptr,
+                                    0);
+
+    if (samples_count < 0) {
+        return DECODER_UNEXPECTED_ERROR;
+    }
+
+    *data_ref = stream_ctx->converted_data;
+    return samples_count;
+}
+
+// Выдает поток, в преобразователе которого могут оставаться семплы после конца нарезки
+decoder_stream_ctx *find_undrained_stream(decoder_ctx *ctx) {
+    for (const auto &stream_ctx : *ctx->stream_contexts) {
+        if (stream_ctx != nullptr && stream_ctx->converter != nullptr && !stream_ctx->converter_drained) {
+            return stream_ctx;
+        }
+    }
 
+    return nullptr;
+}
+
+int decoder_send_packet(void *ctx_ref, void **stream_ref) {
+    auto *casted_ctx = static_cast<decoder_ctx *>(ctx_ref);
+    decoder_stream_ctx *stream_ctx;
+    int stream_index;
+    int send_result = send_next_packet(casted_ctx, -1, &stream_ctx, &stream_index);
+
+    // После конца нарезки потоки по очереди отдают хвосты своих преобразователей
+    if (send_result == DECODER_END_OF_STREAM_ERROR && (stream_ctx = find_undrained_stream(casted_ctx)) != nullptr) {
+        stream_ctx->draining = true;
+        send_result = 0;
+    }
+
+    *stream_ref = stream_ctx;
+    return send_result;
+}
+
+// Получает из кодека следующий аудио-фрейм нарезки в ctx->frame.
+// Возвращает 1, если фрейм получен, и 0, если нужен новый пакет.
+int receive_audio_frame(decoder_ctx *ctx, decoder_stream_ctx *stream_ctx, int64_t *pts) {
     while (true) {
-        int res = avcodec_receive_frame(stream_ctx->context, casted_ctx->frame);
+        int res = avcodec_receive_frame(stream_ctx->context, ctx->frame);
 
         if (res < 0) {
-            av_frame_unref(casted_ctx->frame);
+            av_frame_unref(ctx->frame);
             return res == AVERROR_EOF || res == AVERROR(EAGAIN) ? 0 : DECODER_UNEXPECTED_ERROR;
         }
 
-        auto pts = av_rescale_q(casted_ctx->frame->pts,
-                                stream_ctx->context->pkt_timebase,
-                                AV_TIME_BASE_Q);
+        *pts = av_rescale_q(ctx->frame->pts,
+                            stream_ctx->context->pkt_timebase,
+                            AV_TIME_BASE_Q);
+
+        if (is_frame_before_start(ctx, ctx->frame, *pts)) {
+            av_frame_unref(ctx->frame);
+            continue;
+        }
+
+        if (!is_frame_in_range(ctx, stream_ctx, ctx->frame, *pts)) {
+            ctx->decoded_channels->insert(stream_ctx->index);
+            av_frame_unref(ctx->frame);
+            return 0;
+        }
+
+        if (stream_ctx->codec->type != AVMEDIA_TYPE_AUDIO) {
+            av_frame_unref(ctx->frame);
+            continue;
+        }
+
+        return 1;
+    }
+}
+
+// Преобразует аудио-фрейм в формат вывода потока, записывая семплы в новый буффер со счетчиком ссылок
+int convert_frame_to_ref(decoder_stream_ctx *stream_ctx, AVFrame *frame, AVFrame *output) {
+    output->format = stream_ctx->output_sample_format;
+    output->sample_rate = stream_ctx->output_sample_rate;
+    output->channel_layout = stream_ctx->output_channel_layout;
+    output->channels = stream_ctx->output_channels_count;
+    output->nb_samples = swr_get_out_samples(stream_ctx->converter, frame->nb_samples);
+
+    if (av_frame_get_buffer(output, 0) < 0) {
+        return DECODER_UNEXPECTED_ERROR;
+    }
+
+    int samples_count = swr_convert(stream_ctx->converter,
+                                    output->extended_data,
+                                    output->nb_samples,
+                                    const_cast<const uint8_t **>(frame->extended_data),
+                                    frame->nb_samples);
+
+    if (samples_count < 0) {
+        return DECODER_UNEXPECTED_ERROR;
+    }
+
+    update_converted_end_pts(stream_ctx, frame);
+    output->nb_samples = samples_count;
+    return samples_count;
+}
+
+// Забирает хвост преобразователя в новый буффер со счетчиком ссылок. Возвращает количество семплов.
+int drain_converter_to_ref(decoder_stream_ctx *stream_ctx, AVFrame *output) {
+    uint8_t **data;
+    int samples_count = drain_converter(stream_ctx, &data, &output->pts);
+
+    if (samples_count <= 0) {
+        return samples_count;
+    }
+
+    output->format = stream_ctx->output_sample_format;
+    output->sample_rate = stream_ctx->output_sample_rate;
+    output->channel_layout = stream_ctx->output_channel_layout;
+    output->channels = stream_ctx->output_channels_count;
+    output->nb_samples = samples_count;
+
+    if (av_frame_get_buffer(output, 0) < 0) {
+        return DECODER_UNEXPECTED_ERROR;
+    }
+
+    av_samples_copy(output->extended_data,
+                    data,
+                    0,
+                    0,
+                    samples_count,
+                    stream_ctx->output_channels_count,
+                    stream_ctx->output_sample_format);
+    return samples_count;
+}
+
+int decoder_receive_frame(void *ctx_ref,
+                          void *stream_ref,
+                          const uint8_t ***data,
+                          size_t *bytes_count,
+                          int64_t *pts) {
+    auto *casted_ctx = static_cast<decoder_ctx *>(ctx_ref);
+    auto *stream_ctx = static_cast<decoder_stream_ctx *>(stream_ref);
+    int res;
+
+    if (stream_ctx->draining) {
+        stream_ctx->draining = false;
+        uint8_t **converted_data;
+        int samples_count = drain_converter(stream_ctx, &converted_data, pts);
+
+        if (samples_count <= 0) {
+            return samples_count < 0 ? DECODER_UNEXPECTED_ERROR : 0;
+        }
+
+        *data = const_cast<const uint8_t **>(converted_data);
+        *bytes_count = get_output_bytes_count(stream_ctx, samples_count);
+        return 1;
+    }
+
+    while ((res = receive_audio_frame(casted_ctx, stream_ctx, pts)) > 0) {
+        uint8_t **converted_data;
+        int samples_count = convert_frame(stream_ctx, casted_ctx->frame, &converted_data);
+
+        if (samples_count < 0) {
+            av_frame_unref(casted_ctx->frame);
+            return DECODER_UNEXPECTED_ERROR;
+        } else if (samples_count == 0) {
+            av_frame_unref(casted_ctx->frame);
+            continue;
+        }
+
+        *data = const_cast<const uint8_t **>(converted_data);
+        *bytes_count = get_output_bytes_count(stream_ctx, samples_count);
+        return 1;
+    }
+
+    return res;
+}
+
+int decoder_receive_frame_ref(void *ctx_ref, void *stream_ref, AVFrame **frame_ref) {
+    auto *casted_ctx = static_cast<decoder_ctx *>(ctx_ref);
+    auto *stream_ctx = static_cast<decoder_stream_ctx *>(stream_ref);
+    int64_t pts;
+    int res;
+
+    if (stream_ctx->draining) {
+        stream_ctx->draining = false;
+        AVFrame *frame = av_frame_alloc();
+        int samples_count = frame != nullptr ? drain_converter_to_ref(stream_ctx, frame) : DECODER_UNEXPECTED_ERROR;
 
-        if (casted_ctx->duration != -1) {
-            if (!(casted_ctx->frame->flags & AV_FRAME_FLAG_DISCARD)) {
-                if (stream_ctx->prev_pts != 0) {
-                    stream_ctx->current_time += pts - stream_ctx->prev_pts;
+        if (samples_count <= 0) {
+            av_frame_free(&frame);
+            return samples_count < 0 ? DECODER_UNEXPECTED_ERROR : 0;
+        }
+
+        *frame_ref = frame;
+        return 1;
+    }
+
+    while ((res = receive_audio_frame(casted_ctx, stream_ctx, &pts)) > 0) {
+        AVFrame *frame = av_frame_alloc();
+
+        if (frame == nullptr) {
+            av_frame_unref(casted_ctx->frame);
+            return DECODER_UNEXPECTED_ERROR;
+        }
+
+        // Без преобразования ссылка на буфферы кодека передается вызывающему без копирования
+        if (stream_ctx->converter == nullptr) {
+            av_frame_move_ref(frame, casted_ctx->frame);
+        } else {
+            int samples_count = convert_frame_to_ref(stream_ctx, casted_ctx->frame, frame);
+            av_frame_unref(casted_ctx->frame);
+
+            if (samples_count <= 0) {
+                av_frame_free(&frame);
+
+                if (samples_count < 0) {
+                    return DECODER_UNEXPECTED_ERROR;
                 }
 
-                stream_ctx->prev_pts = pts;
+                continue;
             }
+        }
+
+        frame->pts = pts;
+        *frame_ref = frame;
+        return 1;
+    }
 
-            if (stream_ctx->current_time > casted_ctx->duration) {
-                casted_ctx->decoded_channels->insert(casted_ctx->packet->stream_index);
-                av_frame_unref(casted_ctx->frame);
-                return 0;
+    return res;
+}
+
+AVFrame *decoder_frame_ref(const AVFrame *frame) {
+    return av_frame_clone(frame);
+}
+
+void decoder_frame_free(AVFrame **frame_ref) {
+    av_frame_free(frame_ref);
+}
+
+void decoder_release_frame(void *ctx_ref) {
+    av_frame_unref(static_cast<decoder_ctx *>(ctx_ref)->frame);
+}
+
+bool decoder_is_range_trimmed(void *ctx_ref) {
+    return static_cast<decoder_ctx *>(ctx_ref)->range_trimmed;
+}
+
+int decoder_read_packet(void *ctx_ref, AVPacket *packet) {
+    auto *casted_ctx = static_cast<decoder_ctx *>(ctx_ref);
+
+    while (casted_ctx->decoded_channels->size() < casted_ctx->selected_streams_count) {
+        int read_frame_result = read_next_packet(casted_ctx);
+
+        if (read_frame_result == AVERROR_EOF) {
+            break;
+        } else if (read_frame_result < 0) {
+            return DECODER_UNEXPECTED_ERROR;
+        }
+
+        AVPacket *read_packet = casted_ctx->packet;
+        decoder_stream_ctx *stream_ctx = (*casted_ctx->stream_contexts)[read_packet->stream_index];
+
+        if (stream_ctx == nullptr
+            || casted_ctx->decoded_channels->contains(read_packet->stream_index)
+            || read_packet->pts == AV_NOPTS_VALUE) {
+            av_packet_unref(read_packet);
+            continue;
+        }
+
+        AVRational time_base = stream_ctx->context->pkt_timebase;
+        int64_t pts = av_rescale_q(read_packet->pts, time_base, AV_TIME_BASE_Q);
+        int64_t end = av_rescale_q(read_packet->pts + read_packet->duration, time_base, AV_TIME_BASE_Q);
+
+        // Пакет без декодирования пропускается целиком, если из него не выдается ни одного семпла нарезки
+        if (casted_ctx->start_time != AV_NOPTS_VALUE && end <= casted_ctx->start_time) {
+            casted_ctx->skipped_packets_count++;
+            av_packet_unref(read_packet);
+            continue;
+        }
+
+        if (!is_packet_in_range(casted_ctx, stream_ctx, pts)) {
+            casted_ctx->decoded_channels->insert(stream_ctx->index);
+            av_packet_unref(read_packet);
+            continue;
+        }
+
+        av_packet_move_ref(packet, read_packet);
+        av_packet_rescale_ts(packet, time_base, AVRational{1, stream_ctx->context->sample_rate});
+        return 1;
+    }
+
+    return DECODER_END_OF_STREAM_ERROR;
+}
+
+int decoder_decode(void *ctx_ref,
+                   const std::function<bool(const uint8_t **, size_t, int64_t)> &handle_frame) {
+    return decoder_decode<const std::function<bool(const uint8_t **, size_t, int64_t)> &>(ctx_ref,
+                                                                                        handle_frame);
+}
+
+// Получает следующий фрейм указанного потока, при необходимости дочитывая пакеты
+int receive_next_frame(decoder_ctx *ctx, decoder_stream_ctx *stream_ctx, int stream_index) {
+    while (true) {
+        int res = avcodec_receive_frame(stream_ctx->context, ctx->frame);
+
+        if (res == AVERROR(EAGAIN)) {
+            decoder_stream_ctx *packet_stream_ctx;
+            int packet_stream_index;
+            int send_result = send_next_packet(ctx, stream_index, &packet_stream_ctx, &packet_stream_index);
+
+            if (send_result < 0) {
+                return send_result;
             }
+
+            continue;
+        } else if (res < 0) {
+            av_frame_unref(ctx->frame);
+            return res == AVERROR_EOF ? DECODER_END_OF_STREAM_ERROR : DECODER_UNEXPECTED_ERROR;
         }
 
-        int bytes_per_sample = av_get_bytes_per_sample(stream_ctx->context->sample_fmt);
+        ctx->frame_pts = av_rescale_q(ctx->frame->pts,
+                                      stream_ctx->context->pkt_timebase,
+                                      AV_TIME_BASE_Q);
 
-        if (stream_ctx->codec->type == AVMEDIA_TYPE_AUDIO) {
-            auto const_data = const_cast<const uint8_t **>(casted_ctx->frame->data);
-            std::size_t bytes_count = casted_ctx->frame->nb_samples * bytes_per_sample;
+        if (is_frame_before_start(ctx, ctx->frame, ctx->frame_pts)) {
+            av_frame_unref(ctx->frame);
+            continue;
+        }
+
+        if (!is_frame_in_range(ctx, stream_ctx, ctx->frame, ctx->frame_pts)) {
+            ctx->decoded_channels->insert(stream_index);
+            av_frame_unref(ctx->frame);
+            return DECODER_END_OF_STREAM_ERROR;
+        }
 
-            if (!av_sample_fmt_is_planar(stream_ctx->context->sample_fmt)) {
-                bytes_count *= casted_ctx->frame->channels;
+        int samples_count = convert_frame(stream_ctx, ctx->frame, &ctx->frame_data);
+
+        if (samples_count < 0) {
+            av_frame_unref(ctx->frame);
+            return DECODER_UNEXPECTED_ERROR;
+        } else if (samples_count == 0) {
+            av_frame_unref(ctx->frame);
+            continue;
+        }
+
+        ctx->frame_samples_count = samples_count;
+        ctx->frame_offset = 0;
+        ctx->frame_pending = true;
+        return 0;
+    }
+}
+
+// Делает хвост преобразователя потока текущим фреймом блочного декодирования
+int receive_converter_tail(decoder_ctx *ctx, decoder_stream_ctx *stream_ctx) {
+    int samples_count = drain_converter(stream_ctx, &ctx->frame_data, &ctx->frame_pts);
+
+    if (samples_count <= 0) {
+        return samples_count < 0 ? DECODER_UNEXPECTED_ERROR : DECODER_END_OF_STREAM_ERROR;
+    }
+
+    ctx->frame_samples_count = samples_count;
+    ctx->frame_offset = 0;
+    ctx->frame_pending = true;
+    return 0;
+}
+
+int decoder_decode_batch(void *ctx_ref,
+                         size_t stream_index,
+                         uint8_t **output,
+                         int max_samples_count,
+                         decoder_frame_descriptor *descriptors,
+                         int max_frames_count) {
+    auto *casted_ctx = static_cast<decoder_ctx *>(ctx_ref);
+    decoder_stream_ctx *stream_ctx = (*casted_ctx->stream_contexts)[stream_index];
+
+    if (stream_ctx == nullptr || stream_ctx->codec->type != AVMEDIA_TYPE_AUDIO) {
+        return DECODER_UNEXPECTED_ERROR;
+    }
+
+    int frames_count = 0;
+    int samples_count = 0;
+
+    while (frames_count < max_frames_count && samples_count < max_samples_count) {
+        if (!casted_ctx->frame_pending) {
+            int result = casted_ctx->decoded_channels->contains((int) stream_index)
+                         ? DECODER_END_OF_STREAM_ERROR
+                         : receive_next_frame(casted_ctx, stream_ctx, (int) stream_index);
+
+            if (result == DECODER_END_OF_STREAM_ERROR) {
+                result = receive_converter_tail(casted_ctx, stream_ctx);
             }
 
-            bool result = handle_frame(const_data, bytes_count, pts);
+            if (result == DECODER_END_OF_STREAM_ERROR) {
+                break;
+            } else if (result < 0) {
+                return result;
+            }
+        }
+
+        // Фрейм, не поместившийся в блок целиком, будет дочитан при следующем вызове
+        int copy_count = std::min(casted_ctx->frame_samples_count - casted_ctx->frame_offset,
+                                  max_samples_count - samples_count);
+
+        av_samples_copy(output,
+                        casted_ctx->frame_data,
+                        samples_count,
+                        casted_ctx->frame_offset,
+                        copy_count,
+                        stream_ctx->output_channels_count,
+                        stream_ctx->output_sample_format);
+
+        descriptors[frames_count++] = decoder_frame_descriptor{
+            casted_ctx->frame_pts
+                + av_rescale(casted_ctx->frame_offset, AV_TIME_BASE, stream_ctx->output_sample_rate),
+            copy_count
+        };
+
+        samples_count += copy_count;
+        casted_ctx->frame_offset += copy_count;
+
+        if (casted_ctx->frame_offset >= casted_ctx->frame_samples_count) {
             av_frame_unref(casted_ctx->frame);
+            casted_ctx->frame_pending = false;
+        }
+    }
 
-            if (!result) {
-                return DECODER_UNEXPECTED_ERROR;
-            }
+    return frames_count > 0 ? frames_count : DECODER_END_OF_STREAM_ERROR;
+}
+
+// Поток декодирования одного медиа-потока при параллельном декодировании
+struct decoder_stream_worker {
+  decoder_stream_ctx *stream_ctx = nullptr;
+  AVFrame *frame = nullptr;
+  decoder_packet_queue queue;
+  std::thread thread;
+  std::atomic<bool> finished = false;
+};
+
+// Получает из кодека все готовые фреймы и передает их в обработчик.
+// Возвращает 1, если поток дошел до конца нарезки.
+int receive_worker_frames(decoder_ctx *ctx,
+                          decoder_stream_worker *worker,
+                          const std::function<bool(size_t, const uint8_t **, size_t, int64_t)> &handle_frame) {
+    decoder_stream_ctx *stream_ctx = worker->stream_ctx;
+
+    while (true) {
+        int res = avcodec_receive_frame(stream_ctx->context, worker->frame);
+
+        if (res == AVERROR(EAGAIN) || res == AVERROR_EOF) {
+            return 0;
+        } else if (res < 0) {
+            return DECODER_UNEXPECTED_ERROR;
+        }
+
+        int64_t pts = av_rescale_q(worker->frame->pts, stream_ctx->context->pkt_timebase, AV_TIME_BASE_Q);
+
+        if (is_frame_before_start(ctx, worker->frame, pts)) {
+            av_frame_unref(worker->frame);
+            continue;
+        }
+
+        if (!is_frame_in_range(ctx, stream_ctx, worker->frame, pts)) {
+            av_frame_unref(worker->frame);
+            return 1;
+        }
+
+        if (stream_ctx->codec->type != AVMEDIA_TYPE_AUDIO) {
+            av_frame_unref(worker->frame);
+            continue;
+        }
+
+        uint8_t **converted_data;
+        int samples_count = convert_frame(stream_ctx, worker->frame, &converted_data);
+        bool handled = samples_count == 0
+            || (samples_count > 0 && handle_frame(stream_ctx->index,
+                                                  const_cast<const uint8_t **>(converted_data),
+                                                  get_output_bytes_count(stream_ctx, samples_count),
+                                                  pts));
+        av_frame_unref(worker->frame);
+
+        if (!handled) {
+            return DECODER_UNEXPECTED_ERROR;
+        }
+    }
+}
+
+// Декодирует пакеты из очереди потока, пока они не закончатся или поток не дойдет до конца нарезки
+void run_stream_worker(decoder_ctx *ctx,
+                       decoder_stream_worker *worker,
+                       const std::function<bool(size_t, const uint8_t **, size_t, int64_t)> &handle_frame,
+                       std::atomic<int> *error,
+                       scheduler_priority priority) {
+    scheduler_slot_guard slot(priority);
+    AVCodecContext *context = worker->stream_ctx->context;
+    AVPacket *packet;
+    int result = 0;
+
+    while (result == 0 && error->load() == 0 && decoder_packet_queue_pop(&worker->queue, &packet)) {
+        result = !apply_pending_skip_samples(worker->stream_ctx, packet) || avcodec_send_packet(context, packet) < 0
+                 ? DECODER_UNEXPECTED_ERROR
+                 : receive_worker_frames(ctx, worker, handle_frame);
+        av_packet_free(&packet);
+    }
+
+    // Дочитываем задержанные кодеком фреймы, если файл закончился раньше нарезки
+    if (result == 0 && error->load() == 0) {
+        result = avcodec_send_packet(context, nullptr) < 0
+                 ? DECODER_UNEXPECTED_ERROR
+                 : receive_worker_frames(ctx, worker, handle_frame);
+    }
+
+    // Отдаем обработчику хвост преобразователя
+    uint8_t **tail_data;
+    int64_t tail_pts;
+    int tail_samples_count = result >= 0 && error->load() == 0
+                             ? drain_converter(worker->stream_ctx, &tail_data, &tail_pts)
+                             : 0;
+
+    if (tail_samples_count < 0) {
+        result = DECODER_UNEXPECTED_ERROR;
+    } else if (tail_samples_count > 0
+        && !handle_frame(worker->stream_ctx->index,
+                         const_cast<const uint8_t **>(tail_data),
+                         get_output_bytes_count(worker->stream_ctx, tail_samples_count),
+                         tail_pts)) {
+        result = DECODER_UNEXPECTED_ERROR;
+    }
+
+    if (result < 0) {
+        int expected = 0;
+        error->compare_exchange_strong(expected, result);
+    }
+
+    worker->finished = true;
+    decoder_packet_queue_close(&worker->queue);
+}
+
+int decoder_decode_streams(void *ctx_ref,
+                           const std::function<bool(size_t, const uint8_t **, size_t, int64_t)> &handle_frame,
+                           int packets_queue_capacity) {
+    auto *casted_ctx = static_cast<decoder_ctx *>(ctx_ref);
+    std::vector<std::unique_ptr<decoder_stream_worker>> workers(casted_ctx->stream_contexts->size());
+    std::atomic<int> error = 0;
+
+    for (size_t i = 0; i < workers.size(); ++i) {
+        decoder_stream_ctx *stream_ctx = (*casted_ctx->stream_contexts)[i];
+
+        if (stream_ctx == nullptr || casted_ctx->decoded_channels->contains((int) i)) {
+            continue;
+        }
+
+        workers[i] = std::make_unique<decoder_stream_worker>();
+        workers[i]->stream_ctx = stream_ctx;
+        workers[i]->frame = av_frame_alloc();
+        workers[i]->queue.capacity = std::max(packets_queue_capacity, 1);
+    }
+
+    for (auto &worker : workers) {
+        if (worker != nullptr) {
+            worker->thread = std::thread(run_stream_worker,
+                                         casted_ctx,
+                                         worker.get(),
+                                         std::cref(handle_frame),
+                                         &error,
+                                         scheduler_get_thread_priority());
         }
     }
+
+    int result = 0;
+
+    // Демуксим файл один раз, раздавая пакеты по очередям потоков
+    while (error.load() == 0) {
+        bool all_finished = std::all_of(workers.cbegin(), workers.cend(), [](const auto &worker) {
+          return worker == nullptr || worker->finished;
+        });
+
+        if (all_finished) {
+            break;
+        }
+
+        int read_frame_result = read_next_packet(casted_ctx);
+
+        if (read_frame_result == AVERROR_EOF) {
+            break;
+        } else if (read_frame_result < 0) {
+            result = DECODER_UNEXPECTED_ERROR;
+            break;
+        }
+
+        int stream_index = casted_ctx->packet->stream_index;
+        decoder_stream_worker *worker = stream_index < (int) workers.size() ? workers[stream_index].get() : nullptr;
+
+        if (worker == nullptr || worker->finished) {
+            av_packet_unref(casted_ctx->packet);
+            continue;
+        } else if (is_packet_before_preroll(casted_ctx, worker->stream_ctx, casted_ctx->packet)) {
+            casted_ctx->skipped_packets_count++;
+            av_packet_unref(casted_ctx->packet);
+            continue;
+        }
+
+        AVPacket *packet = av_packet_alloc();
+        av_packet_move_ref(packet, casted_ctx->packet);
+
+        if (!decoder_packet_queue_push(&worker->queue, packet)) {
+            av_packet_free(&packet);
+        }
+    }
+
+    for (size_t i = 0; i < workers.size(); ++i) {
+        if (workers[i] == nullptr) {
+            continue;
+        }
+
+        decoder_packet_queue_finish(&workers[i]->queue);
+        scheduler_join(workers[i]->thread);
+        av_frame_free(&workers[i]->frame);
+        casted_ctx->decoded_channels->insert((int) i);
+    }
+
+    return error.load() != 0 ? error.load() : result;
+}
+
+bool decoder_is_stream_selected(void *ctx_ref, size_t stream_index) {
+    auto stream_contexts = static_cast<decoder_ctx *>(ctx_ref)->stream_contexts;
+    return stream_index < stream_contexts->size() && (*stream_contexts)[stream_index] != nullptr;
+}
+
+int decoder_get_read_ahead_stats(void *ctx_ref, decoder_read_ahead_stats *stats) {
+    auto *casted_ctx = static_cast<decoder_ctx *>(ctx_ref);
+
+    if (casted_ctx->read_ahead == nullptr) {
+        return DECODER_UNEXPECTED_ERROR;
+    }
+
+    decoder_read_ahead_get_stats(casted_ctx->read_ahead, stats);
+    return 0;
 }
 
 int decoder_get_sample_rate(void *ctx_ref, size_t stream_index) {
-    return (*static_cast<decoder_ctx *>(ctx_ref)->stream_contexts)[stream_index]->context->sample_rate;
+    return (*static_cast<decoder_ctx *>(ctx_ref)->stream_contexts)[stream_index]->output_sample_rate;
 }
 
 int decoder_get_channels_count(void *ctx_ref, size_t stream_index) {
-    return (*static_cast<decoder_ctx *>(ctx_ref)->stream_contexts)[stream_index]->context->channels;
+    return (*static_cast<decoder_ctx *>(ctx_ref)->stream_contexts)[stream_index]->output_channels_count;
 }
 
 uint64_t decoder_get_channel_layout(void *ctx_ref, size_t stream_index) {
-    auto casted_ctx = static_cast<decoder_ctx *>(ctx_ref);
-    auto layout = (*casted_ctx->stream_contexts)[stream_index]->context->channel_layout;
-
-    if (layout == 0) {
-        return av_get_default_channel_layout(decoder_get_channels_count(ctx_ref, stream_index));
-    }
+    return (*static_cast<decoder_ctx *>(ctx_ref)->stream_contexts)[stream_index]->output_channel_layout;
+}
 
-    return layout;
+const AVCodecParameters *decoder_get_codec_parameters(void *ctx_ref, size_t stream_index) {
+    return static_cast<decoder_ctx *>(ctx_ref)->format_ctx->streams[stream_index]->codecpar;
 }
 
 AVSampleFormat decoder_get_sample_format(void *ctx_ref, size_t stream_index) {
-    return (*static_cast<decoder_ctx *>(ctx_ref)->stream_contexts)[stream_index]->context->sample_fmt;
+    return (*static_cast<decoder_ctx *>(ctx_ref)->stream_contexts)[stream_index]->output_sample_format;
 }
 
 int64_t decoder_get_duration_in_us(void *ctx_ref) {
@@ -257,12 +1471,23 @@ void decoder_free(void **ctx_ref) {
     auto casted_ctx_ref = reinterpret_cast<decoder_ctx **>(ctx_ref);
     auto casted_ctx = *casted_ctx_ref;
 
-    free_stream_contexts(casted_ctx->stream_contexts);
-    avformat_close_input(&casted_ctx->format_ctx);
+    if (casted_ctx->read_ahead != nullptr) {
+        decoder_read_ahead_stop(&casted_ctx->read_ahead);
+    }
+
+    free_stream_contexts(casted_ctx->stream_contexts, casted_ctx->pool);
+    close_input(&casted_ctx->format_ctx, &casted_ctx->io_ctx);
+    *casted_ctx_ref = nullptr;
+
+    // Выданный пулом декодер возвращается в него вместе с фреймом и пакетом
+    if (casted_ctx->pool != nullptr) {
+        decoder_pool_put_shell(casted_ctx->pool, casted_ctx);
+        return;
+    }
+
     av_packet_free(&casted_ctx->packet);
     av_frame_free(&casted_ctx->frame);
     delete casted_ctx->decoded_channels;
 
     delete casted_ctx;
-    *casted_ctx_ref = nullptr;
 }
@@ -2,27 +2,179 @@
 #define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_DECODER_DECODER_HPP_
 
 extern "C" {
+#include <libavcodec/codec_par.h>
+#include <libavcodec/packet.h>
 #include <libavutil/mem.h>
 #include <libavutil/samplefmt.h>
+#include <libavutil/frame.h>
 }
 
+#include "decoder_errors.hpp"
+#include "decoder_options.hpp"
+
 #include <unordered_set>
 #include <functional>
 #include <cstdint>
 #include <vector>
 #include <deque>
 
+// Описание фрагмента фрейма, выданного пакетным декодированием
+struct decoder_frame_descriptor {
+  int64_t pts;
+  int samples_count;
+};
+
+// Счетчики очереди упреждающего чтения
+struct decoder_read_ahead_stats {
+  int64_t capacity;
+  int64_t depth;
+  int64_t max_depth;
+  int64_t packets_count;
+  // Сколько раз поток чтения ждал освобождения места в очереди
+  int64_t reader_stalls_count;
+  // Сколько раз декодер ждал чтения пакета
+  int64_t decoder_stalls_count;
+};
+
 // Инициализирует декодер
 int decoder_init(void **ctx_ref,
                  const char *path,
                  int64_t start_moment,
                  int64_t end_moment,
-                 std::unordered_set<AVMediaType> &streams_types);
+                 std::unordered_set<AVMediaType> &streams_types,
+                 const decoder_options &options = decoder_options{});
+
+// Инициализирует декодер, читающий медиа-контент из памяти вызывающего.
+// Память не копируется и должна оставаться доступной до освобождения декодера.
+int decoder_init_from_memory(void **ctx_ref,
+                             const uint8_t *data,
+                             size_t size,
+                             int64_t start_moment,
+                             int64_t end_moment,
+                             std::unordered_set<AVMediaType> &streams_types,
+                             const decoder_options &options = decoder_options{});
+
+// Инициализирует декодер, последовательно читающий медиа-контент из файлового дескриптора,
+// например из канала. Вход не перематывается: фреймы до начала нарезки декодируются и отбрасываются.
+// Дескриптор не закрывается декодером.
+int decoder_init_from_fd(void **ctx_ref,
+                         int fd,
+                         int64_t start_moment,
+                         int64_t end_moment,
+                         std::unordered_set<AVMediaType> &streams_types,
+                         const decoder_options &options = decoder_options{});
+
+// Читает следующий пакет и отправляет его в декодер. В stream_ref записывается поток,
+// получивший пакет, либо nullptr, если пакет был пропущен.
+int decoder_send_packet(void *ctx_ref, void **stream_ref);
+
+// Получает следующий аудио-фрейм потока. Возвращает 1, если фрейм получен, и 0, если нужен новый пакет.
+// Данные фрейма действительны до вызова decoder_release_frame.
+int decoder_receive_frame(void *ctx_ref,
+                          void *stream_ref,
+                          const uint8_t ***data,
+                          size_t *bytes_count,
+                          int64_t *pts);
+
+// Освобождает фрейм, полученный через decoder_receive_frame
+void decoder_release_frame(void *ctx_ref);
+
+// Получает следующий аудио-фрейм потока в виде отдельного фрейма со счетчиком ссылок,
+// который остается действительным после следующих вызовов декодера и может передаваться между потоками.
+// pts фрейма пересчитан в микросекунды. Возвращает 1, если фрейм получен, и 0, если нужен новый пакет.
+int decoder_receive_frame_ref(void *ctx_ref, void *stream_ref, AVFrame **frame_ref);
+
+// Создает еще одну ссылку на фрейм без копирования семплов
+AVFrame *decoder_frame_ref(const AVFrame *frame);
+
+// Освобождает ссылку на фрейм, полученный через decoder_receive_frame_ref или decoder_frame_ref
+void decoder_frame_free(AVFrame **frame_ref);
+
+// Выполняет декодирование, передавая фреймы в произвольный обработчик.
+// Обработчик не стирается до std::function, поэтому компилятор может встроить его в цикл.
+template<typename Sink>
+int decoder_decode(void *ctx_ref, Sink &&handle_frame) {
+    void *stream_ref;
+    int result = decoder_send_packet(ctx_ref, &stream_ref);
+
+    if (result < 0 || stream_ref == nullptr) {
+        return result;
+    }
+
+    const uint8_t **data;
+    size_t bytes_count;
+    int64_t pts;
+
+    while ((result = decoder_receive_frame(ctx_ref, stream_ref, &data, &bytes_count, &pts)) > 0) {
+        bool handled = handle_frame(data, bytes_count, pts);
+        decoder_release_frame(ctx_ref);
+
+        if (!handled) {
+            return DECODER_UNEXPECTED_ERROR;
+        }
+    }
+
+    return result;
+}
+
+// Выполняет декодирование, передавая обработчику фреймы со счетчиком ссылок.
+// Обработчик становится владельцем фрейма и освобождает его через decoder_frame_free.
+template<typename Sink>
+int decoder_decode_frames(void *ctx_ref, Sink &&handle_frame) {
+    void *stream_ref;
+    int result = decoder_send_packet(ctx_ref, &stream_ref);
+
+    if (result < 0 || stream_ref == nullptr) {
+        return result;
+    }
+
+    AVFrame *frame;
+
+    while ((result = decoder_receive_frame_ref(ctx_ref, stream_ref, &frame)) > 0) {
+        if (!handle_frame(frame)) {
+            return DECODER_UNEXPECTED_ERROR;
+        }
+    }
+
+    return result;
+}
+
+// Проверяет, что декодируется нарезка, а не весь файл целиком
+bool decoder_is_range_trimmed(void *ctx_ref);
+
+// Читает следующий сжатый пакет выбранного потока из нарезки, не декодируя его.
+// Границы нарезки определяются так же, как при декодировании. pts, dts и длительность пакета
+// пересчитаны в семплы потока. Возвращает 1, если пакет получен.
+int decoder_read_packet(void *ctx_ref, AVPacket *packet);
 
 // Выполняет декодирование
 int decoder_decode(void *ctx_ref,
                    const std::function<bool(const uint8_t **, size_t, int64_t)> &handle_frame);
 
+// Декодирует аудио-поток с указанным индексом в блок вызывающего, пока в нем есть место
+// под max_samples_count семплов или не выдано max_frames_count фрагментов фреймов.
+// Семплы пишутся в формате потока, возвращается количество заполненных описаний.
+int decoder_decode_batch(void *ctx_ref,
+                         size_t stream_index,
+                         uint8_t **output,
+                         int max_samples_count,
+                         decoder_frame_descriptor *descriptors,
+                         int max_frames_count);
+
+// Декодирует все выбранные потоки параллельно: файл читается один раз, а пакеты каждого потока
+// передаются через ограниченную очередь в отдельный поток декодирования. Обработчик вызывается
+// из потоков декодирования, для одного медиа-потока вызовы идут последовательно.
+// Возвращает 0, если все потоки декодированы до конца.
+int decoder_decode_streams(void *ctx_ref,
+                           const std::function<bool(size_t, const uint8_t **, size_t, int64_t)> &handle_frame,
+                           int packets_queue_capacity = 16);
+
+// Проверяет, декодируется ли поток с указанным индексом
+bool decoder_is_stream_selected(void *ctx_ref, size_t stream_index);
+
+// Выдает счетчики очереди упреждающего чтения. Возвращает ошибку, если упреждающее чтение выключено.
+int decoder_get_read_ahead_stats(void *ctx_ref, decoder_read_ahead_stats *stats);
+
 // Выдает частоту дискретизации потока с указанным индексом
 int decoder_get_sample_rate(void *ctx_ref, size_t stream_index);
 
@@ -32,6 +184,9 @@ int decoder_get_channels_count(void *ctx_ref, size_t stream_index);
 // Выдает формат канала потока с указанным индексом
 uint64_t decoder_get_channel_layout(void *ctx_ref, size_t stream_index);
 
+// Выдает параметры сжатых данных потока с указанным индексом
+const AVCodecParameters *decoder_get_codec_parameters(void *ctx_ref, size_t stream_index);
+
 // Выдает формат записи семплов в файле
 AVSampleFormat decoder_get_sample_format(void *ctx_ref, size_t stream_index);
 
@@ -41,7 +196,7 @@ uint32_t decoder_get_streams_count(void *ctx_ref);
 // Выдает длительность медиа-контента в микросекундах
 int64_t decoder_get_duration_in_us(void *ctx_ref);
 
-// Освобождает ресурсы
+// Освобождает ресурсы. Декодер, выданный пулом, возвращается в него.
 void decoder_free(void **ctx_ref);
 
 #endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_DECODER_DECODER_HPP_
\ No newline at end of file
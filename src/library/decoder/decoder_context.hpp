@@ -4,6 +4,7 @@
 extern "C" {
 #include <libavformat/avformat.h>
 #include <libavcodec/avcodec.h>
+#include <libswresample/swresample.h>
 }
 
 #include <unordered_set>
@@ -13,8 +14,36 @@ struct decoder_stream_ctx {
   AVCodecContext *context = nullptr;
   int64_t current_time = 0;
   int64_t prev_pts = 0;
+  int index = -1;
+  AVCodecParameters *params = nullptr;
+  // Формат выдаваемых семплов, совпадает с форматом кодека, если преобразование не запрошено
+  AVSampleFormat output_sample_format = AV_SAMPLE_FMT_NONE;
+  int output_sample_rate = 0;
+  uint64_t output_channel_layout = 0;
+  int output_channels_count = 0;
+  SwrContext *converter = nullptr;
+  uint8_t **converted_data = nullptr;
+  int converted_capacity = 0;
+  // Конец последнего преобразованного фрейма в микросекундах
+  int64_t converted_end_pts = 0;
+  // Семплы, оставшиеся в преобразователе после конца нарезки, уже выданы или выдаются сейчас
+  bool converter_drained = false;
+  bool draining = false;
+  // Длительность данных до начала нарезки в микросекундах, нужная кодеку для точного декодирования.
+  // -1, если пакеты до начала нарезки пропускать нельзя.
+  int64_t preroll = -1;
+  // В кодек отправлен пустой пакет конца файла
+  bool codec_flushed = false;
+  // Многопоточность, с которой открыт кодек
+  int threads_count = 1;
+  int thread_type = 0;
+  // Семплы, которые нужно пропустить в начале взятого из пула кодека, -1 если не нужно
+  int64_t pending_skip_samples = -1;
 };
 
+struct decoder_pool_ctx;
+struct decoder_read_ahead_ctx;
+
 struct decoder_ctx {
   AVFrame* frame = nullptr;
   AVPacket *packet = nullptr;
@@ -22,6 +51,20 @@ struct decoder_ctx {
   std::vector<decoder_stream_ctx *> *stream_contexts = nullptr;
   std::unordered_set<int> *decoded_channels = nullptr;
   int64_t duration = -1;
+  std::size_t selected_streams_count = 0;
+  AVIOContext *io_ctx = nullptr;
+  bool frame_pending = false;
+  int frame_offset = 0;
+  int64_t frame_pts = 0;
+  uint8_t **frame_data = nullptr;
+  int frame_samples_count = 0;
+  decoder_pool_ctx *pool = nullptr;
+  decoder_read_ahead_ctx *read_ahead = nullptr;
+  // Начало нарезки в микросекундах, если пре-ролл пропускается, иначе AV_NOPTS_VALUE
+  int64_t start_time = AV_NOPTS_VALUE;
+  int64_t skipped_packets_count = 0;
+  // Запрошена нарезка, а не весь файл целиком
+  bool range_trimmed = false;
 };
 
 #endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_DECODER_DECODER_CONTEXT_HPP_
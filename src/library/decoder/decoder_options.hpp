@@ -0,0 +1,51 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_DECODER_DECODER_OPTIONS_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_DECODER_DECODER_OPTIONS_HPP_
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avio.h>
+#include <libavutil/samplefmt.h>
+}
+
+// Политика выбора количества потоков декодирования
+enum decoder_threads_policy {
+  // Декодирование в одном потоке
+  DECODER_THREADS_SINGLE,
+  // Количество потоков задается в threads_count
+  DECODER_THREADS_FIXED,
+  // Количество потоков выбирается по числу ядер и длине декодируемого фрагмента
+  DECODER_THREADS_AUTO
+};
+
+// Способ чтения входного файла
+enum decoder_input_mode {
+  // Чтение через протокол file из FFmpeg
+  DECODER_INPUT_FILE_PROTOCOL,
+  // Чтение из отображения файла в память
+  DECODER_INPUT_MMAP
+};
+
+struct decoder_options {
+  decoder_threads_policy threads_policy = DECODER_THREADS_SINGLE;
+  int threads_count = 1;
+  int thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+  // Путь к индексу перемотки, построенному через seek_index_build. Устаревший индекс игнорируется.
+  const char *seek_index_path = nullptr;
+  decoder_input_mode input_mode = DECODER_INPUT_FILE_PROTOCOL;
+  // Индекс единственного декодируемого потока, -1 для всех потоков запрошенных типов
+  int stream_index = -1;
+  // Глубина очереди упреждающего чтения пакетов в отдельном потоке, 0 отключает упреждающее чтение
+  int read_ahead_packets = 0;
+  // Формат, в который аудио-фреймы преобразуются сразу после декодирования.
+  // Незаданные параметры берутся из потока, без параметров фреймы выдаются как есть.
+  AVSampleFormat output_sample_format = AV_SAMPLE_FMT_NONE;
+  int output_sample_rate = 0;
+  uint64_t output_channel_layout = 0;
+  // Не декодировать пакеты до начала нарезки, кроме нужного кодеку пре-ролла,
+  // и не выдавать фреймы, целиком лежащие до начала нарезки
+  bool skip_preroll_packets = false;
+  // Обработчик, прерывающий блокирующее чтение входа, если он вернул не 0
+  AVIOInterruptCB interrupt_callback{nullptr, nullptr};
+};
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_DECODER_DECODER_OPTIONS_HPP_
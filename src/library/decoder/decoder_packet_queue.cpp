@@ -0,0 +1,47 @@
+#include "decoder_packet_queue.hpp"
+#include "../scheduler/scheduler.hpp"
+
+bool decoder_packet_queue_push(decoder_packet_queue *queue, AVPacket *packet) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    scheduler_wait(lock, queue->not_full, [queue] { return queue->closed || queue->packets.size() < queue->capacity; });
+
+    if (queue->closed) {
+        return false;
+    }
+
+    queue->packets.push_back(packet);
+    queue->not_empty.notify_one();
+    return true;
+}
+
+bool decoder_packet_queue_pop(decoder_packet_queue *queue, AVPacket **packet_ref) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    scheduler_wait(lock, queue->not_empty, [queue] { return queue->finished || !queue->packets.empty(); });
+
+    if (queue->packets.empty()) {
+        return false;
+    }
+
+    *packet_ref = queue->packets.front();
+    queue->packets.pop_front();
+    queue->not_full.notify_one();
+    return true;
+}
+
+void decoder_packet_queue_finish(decoder_packet_queue *queue) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->finished = true;
+    queue->not_empty.notify_all();
+}
+
+void decoder_packet_queue_close(decoder_packet_queue *queue) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->closed = true;
+
+    for (auto &packet : queue->packets) {
+        av_packet_free(&packet);
+    }
+
+    queue->packets.clear();
+    queue->not_full.notify_all();
+}
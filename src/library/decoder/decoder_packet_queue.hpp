@@ -0,0 +1,38 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_DECODER_DECODER_PACKET_QUEUE_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_DECODER_DECODER_PACKET_QUEUE_HPP_
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// Ограниченная очередь пакетов между демуксером и декодирующим потоком
+struct decoder_packet_queue {
+  std::mutex mutex;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+  std::deque<AVPacket *> packets;
+  std::size_t capacity = 1;
+  // Писатель больше не будет добавлять пакеты
+  bool finished = false;
+  // Читатель больше не будет забирать пакеты
+  bool closed = false;
+};
+
+// Добавляет пакет, ожидая свободного места. Возвращает false, если очередь закрыта читателем,
+// в этом случае пакет остается во владении вызывающего.
+bool decoder_packet_queue_push(decoder_packet_queue *queue, AVPacket *packet);
+
+// Забирает пакет, ожидая его появления. Возвращает false, если пакетов больше не будет.
+bool decoder_packet_queue_pop(decoder_packet_queue *queue, AVPacket **packet_ref);
+
+// Сообщает читателю, что пакетов больше не будет
+void decoder_packet_queue_finish(decoder_packet_queue *queue);
+
+// Закрывает очередь со стороны читателя и освобождает оставшиеся в ней пакеты
+void decoder_packet_queue_close(decoder_packet_queue *queue);
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_DECODER_DECODER_PACKET_QUEUE_HPP_
@@ -0,0 +1,139 @@
+#include <cstring>
+
+#include "decoder_pool.hpp"
+#include "decoder_pool_context.hpp"
+
+// Проверяет, что кодек был открыт с теми же параметрами потока
+bool is_codec_params_matches(const AVCodecParameters *opened, const AVCodecParameters *requested) {
+    return opened->codec_id == requested->codec_id
+        && opened->codec_type == requested->codec_type
+        && opened->sample_rate == requested->sample_rate
+        && opened->channels == requested->channels
+        && opened->channel_layout == requested->channel_layout
+        && opened->format == requested->format
+        && opened->block_align == requested->block_align
+        && opened->bits_per_coded_sample == requested->bits_per_coded_sample
+        && opened->extradata_size == requested->extradata_size
+        && (opened->extradata_size == 0
+            || memcmp(opened->extradata, requested->extradata, opened->extradata_size) == 0);
+}
+
+// Освобождает кодек
+void free_pool_codec(decoder_pool_codec &codec) {
+    avcodec_free_context(&codec.context);
+    avcodec_parameters_free(&codec.params);
+}
+
+// Освобождает контекст декодера вместе с фреймом и пакетом
+void free_pool_shell(decoder_ctx *ctx) {
+    av_frame_free(&ctx->frame);
+    av_packet_free(&ctx->packet);
+    delete ctx->decoded_channels;
+    delete ctx;
+}
+
+void decoder_pool_init(void **pool_ref, size_t max_idle_codecs) {
+    auto pool = new decoder_pool_ctx();
+    pool->max_idle_codecs = max_idle_codecs;
+    *pool_ref = pool;
+}
+
+bool decoder_pool_take_codec(decoder_pool_ctx *pool,
+                             const AVCodecParameters *params,
+                             int threads_count,
+                             int thread_type,
+                             decoder_pool_codec *codec) {
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    auto codecs = pool->idle_codecs.find(params->codec_id);
+
+    if (codecs == pool->idle_codecs.end()) {
+        return false;
+    }
+
+    for (auto item = codecs->second.begin(); item != codecs->second.end(); ++item) {
+        if (item->threads_count == threads_count
+            && item->thread_type == thread_type
+            && is_codec_params_matches(item->params, params)) {
+            *codec = *item;
+            codecs->second.erase(item);
+            pool->idle_codecs_count--;
+            pool->reused_codecs_count++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void decoder_pool_count_opened_codec(decoder_pool_ctx *pool) {
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    pool->opened_codecs_count++;
+}
+
+void decoder_pool_put_codec(decoder_pool_ctx *pool, decoder_pool_codec codec) {
+    // Сбрасываем внутренние буфферы кодека, чтобы следующий файл декодировался с чистого состояния
+    avcodec_flush_buffers(codec.context);
+
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    auto &codecs = pool->idle_codecs[codec.context->codec_id];
+
+    if (pool->idle_codecs_count >= pool->max_idle_codecs || codecs.size() >= DECODER_POOL_MAX_IDLE_CODECS_PER_ID) {
+        free_pool_codec(codec);
+        return;
+    }
+
+    codecs.push_back(codec);
+    pool->idle_codecs_count++;
+}
+
+decoder_ctx *decoder_pool_take_shell(decoder_pool_ctx *pool) {
+    std::lock_guard<std::mutex> lock(pool->mutex);
+
+    if (pool->idle_shells.empty()) {
+        return nullptr;
+    }
+
+    decoder_ctx *ctx = pool->idle_shells.back();
+    pool->idle_shells.pop_back();
+    return ctx;
+}
+
+void decoder_pool_put_shell(decoder_pool_ctx *pool, decoder_ctx *ctx) {
+    av_frame_unref(ctx->frame);
+    av_packet_unref(ctx->packet);
+    ctx->decoded_channels->clear();
+
+    std::lock_guard<std::mutex> lock(pool->mutex);
+
+    // Всплеск одновременных декодеров не должен навсегда оставлять в пуле лишние контексты
+    if (pool->idle_shells.size() >= pool->max_idle_codecs) {
+        free_pool_shell(ctx);
+        return;
+    }
+
+    pool->idle_shells.push_back(ctx);
+}
+
+void decoder_pool_get_stats(void *pool_ref, int64_t *reused_codecs_count, int64_t *opened_codecs_count) {
+    auto pool = static_cast<decoder_pool_ctx *>(pool_ref);
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    *reused_codecs_count = pool->reused_codecs_count;
+    *opened_codecs_count = pool->opened_codecs_count;
+}
+
+void decoder_pool_free(void **pool_ref) {
+    auto pool = static_cast<decoder_pool_ctx *>(*pool_ref);
+
+    for (auto &item : pool->idle_codecs) {
+        for (auto &codec : item.second) {
+            free_pool_codec(codec);
+        }
+    }
+
+    for (auto &ctx : pool->idle_shells) {
+        free_pool_shell(ctx);
+    }
+
+    delete pool;
+    *pool_ref = nullptr;
+}
@@ -0,0 +1,28 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_DECODER_DECODER_POOL_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_DECODER_DECODER_POOL_HPP_
+
+#include "decoder.hpp"
+
+#include <unordered_set>
+#include <cstdint>
+
+// Создает пул декодеров, хранящий до max_idle_codecs открытых кодеков и столько же контекстов между файлами
+void decoder_pool_init(void **pool_ref, size_t max_idle_codecs);
+
+// Инициализирует декодер, по возможности беря открытые кодеки и буфферы из пула.
+// Может вызываться из нескольких потоков. Декодер возвращается в пул через decoder_free.
+int decoder_pool_acquire(void *pool_ref,
+                         void **ctx_ref,
+                         const char *path,
+                         int64_t start_moment,
+                         int64_t end_moment,
+                         std::unordered_set<AVMediaType> &streams_types,
+                         const decoder_options &options = decoder_options{});
+
+// Выдает количество переиспользованных и заново открытых кодеков
+void decoder_pool_get_stats(void *pool_ref, int64_t *reused_codecs_count, int64_t *opened_codecs_count);
+
+// Освобождает пул. Все выданные им декодеры к этому моменту должны быть освобождены.
+void decoder_pool_free(void **pool_ref);
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_DECODER_DECODER_POOL_HPP_
@@ -0,0 +1,54 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_DECODER_DECODER_POOL_CONTEXT_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_DECODER_DECODER_POOL_CONTEXT_HPP_
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#include "decoder_context.hpp"
+
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+
+// Максимальное количество простаивающих кодеков с одним идентификатором
+#define DECODER_POOL_MAX_IDLE_CODECS_PER_ID 4
+
+// Открытый кодек вместе с параметрами и многопоточностью, с которыми он был открыт
+struct decoder_pool_codec {
+  AVCodecContext *context = nullptr;
+  AVCodecParameters *params = nullptr;
+  int threads_count = 1;
+  int thread_type = 0;
+};
+
+struct decoder_pool_ctx {
+  std::mutex mutex;
+  std::size_t max_idle_codecs = 0;
+  std::size_t idle_codecs_count = 0;
+  std::unordered_map<int, std::vector<decoder_pool_codec>> idle_codecs;
+  std::vector<decoder_ctx *> idle_shells;
+  int64_t reused_codecs_count = 0;
+  int64_t opened_codecs_count = 0;
+};
+
+// Берет из пула кодек, открытый с теми же параметрами, количеством и типом потоков
+bool decoder_pool_take_codec(decoder_pool_ctx *pool,
+                             const AVCodecParameters *params,
+                             int threads_count,
+                             int thread_type,
+                             decoder_pool_codec *codec);
+
+// Учитывает успешно открытый вместо взятого из пула кодек
+void decoder_pool_count_opened_codec(decoder_pool_ctx *pool);
+
+// Сбрасывает состояние кодека и возвращает его в пул
+void decoder_pool_put_codec(decoder_pool_ctx *pool, decoder_pool_codec codec);
+
+// Берет из пула контекст декодера с уже выделенными фреймом, пакетом и контейнерами
+decoder_ctx *decoder_pool_take_shell(decoder_pool_ctx *pool);
+
+// Возвращает в пул контекст декодера, у которого уже закрыт вход и освобождены потоки
+void decoder_pool_put_shell(decoder_pool_ctx *pool, decoder_ctx *ctx);
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_DECODER_DECODER_POOL_CONTEXT_HPP_
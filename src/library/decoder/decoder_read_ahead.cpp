@@ -0,0 +1,100 @@
+#include "decoder_read_ahead.hpp"
+
+// Читает пакеты в свободные ячейки очереди, пока вход не закончится или декодер не закроет очередь
+void run_read_ahead(decoder_read_ahead_ctx *ctx) {
+    uint64_t capacity = ctx->slots.size();
+    uint64_t head = 0;
+
+    while (true) {
+        uint64_t tail = ctx->tail.load(std::memory_order_acquire);
+
+        if (tail & DECODER_READ_AHEAD_CLOSED_FLAG) {
+            return;
+        } else if (head - tail >= capacity) {
+            ctx->reader_stalls_count.fetch_add(1, std::memory_order_relaxed);
+            ctx->tail.wait(tail, std::memory_order_acquire);
+            continue;
+        }
+
+        // Пакет читается сразу в ячейку, забранную декодером, без промежуточного копирования
+        int read_result = av_read_frame(ctx->format_ctx, ctx->slots[head % capacity]);
+
+        if (read_result < 0) {
+            ctx->read_result = read_result;
+            ctx->head.store(head | DECODER_READ_AHEAD_CLOSED_FLAG, std::memory_order_release);
+            ctx->head.notify_one();
+            return;
+        }
+
+        head++;
+        ctx->head.store(head, std::memory_order_release);
+        ctx->head.notify_one();
+
+        auto depth = static_cast<int64_t>(head - tail);
+        ctx->packets_count.fetch_add(1, std::memory_order_relaxed);
+
+        if (depth > ctx->max_depth.load(std::memory_order_relaxed)) {
+            ctx->max_depth.store(depth, std::memory_order_relaxed);
+        }
+    }
+}
+
+void decoder_read_ahead_start(decoder_read_ahead_ctx **ctx_ref, AVFormatContext *format_ctx, size_t capacity) {
+    auto ctx = new decoder_read_ahead_ctx();
+    ctx->format_ctx = format_ctx;
+    ctx->slots.resize(std::max<size_t>(capacity, 1));
+
+    for (auto &slot : ctx->slots) {
+        slot = av_packet_alloc();
+    }
+
+    ctx->thread = std::thread(run_read_ahead, ctx);
+    *ctx_ref = ctx;
+}
+
+int decoder_read_ahead_read(decoder_read_ahead_ctx *ctx, AVPacket *packet) {
+    uint64_t tail = ctx->tail.load(std::memory_order_relaxed);
+
+    while (true) {
+        uint64_t head = ctx->head.load(std::memory_order_acquire);
+
+        if ((head & ~DECODER_READ_AHEAD_CLOSED_FLAG) != tail) {
+            av_packet_move_ref(packet, ctx->slots[tail % ctx->slots.size()]);
+            ctx->tail.store(tail + 1, std::memory_order_release);
+            ctx->tail.notify_one();
+            return 0;
+        } else if (head & DECODER_READ_AHEAD_CLOSED_FLAG) {
+            return ctx->read_result;
+        }
+
+        ctx->decoder_stalls_count.fetch_add(1, std::memory_order_relaxed);
+        ctx->head.wait(head, std::memory_order_acquire);
+    }
+}
+
+void decoder_read_ahead_get_stats(decoder_read_ahead_ctx *ctx, decoder_read_ahead_stats *stats) {
+    uint64_t head = ctx->head.load(std::memory_order_acquire) & ~DECODER_READ_AHEAD_CLOSED_FLAG;
+    uint64_t tail = ctx->tail.load(std::memory_order_acquire) & ~DECODER_READ_AHEAD_CLOSED_FLAG;
+
+    stats->capacity = static_cast<int64_t>(ctx->slots.size());
+    stats->depth = head > tail ? static_cast<int64_t>(head - tail) : 0;
+    stats->max_depth = ctx->max_depth.load(std::memory_order_relaxed);
+    stats->packets_count = ctx->packets_count.load(std::memory_order_relaxed);
+    stats->reader_stalls_count = ctx->reader_stalls_count.load(std::memory_order_relaxed);
+    stats->decoder_stalls_count = ctx->decoder_stalls_count.load(std::memory_order_relaxed);
+}
+
+void decoder_read_ahead_stop(decoder_read_ahead_ctx **ctx_ref) {
+    auto ctx = *ctx_ref;
+
+    ctx->tail.fetch_or(DECODER_READ_AHEAD_CLOSED_FLAG, std::memory_order_release);
+    ctx->tail.notify_one();
+    ctx->thread.join();
+
+    for (auto &slot : ctx->slots) {
+        av_packet_free(&slot);
+    }
+
+    delete ctx;
+    *ctx_ref = nullptr;
+}
@@ -0,0 +1,47 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_DECODER_DECODER_READ_AHEAD_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_DECODER_DECODER_READ_AHEAD_HPP_
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+#include "decoder.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Флаг в счетчике очереди, означающий, что сторона, которой принадлежит счетчик, закончила работу
+#define DECODER_READ_AHEAD_CLOSED_FLAG (1ULL << 63)
+
+// Упреждающее чтение пакетов в отдельном потоке через кольцевую очередь
+// с одним писателем и одним читателем, работающую без блокировок.
+struct decoder_read_ahead_ctx {
+  AVFormatContext *format_ctx = nullptr;
+  std::vector<AVPacket *> slots;
+  // Количество записанных пакетов, пишется только потоком чтения
+  std::atomic<uint64_t> head = 0;
+  // Количество забранных пакетов, пишется только декодером
+  std::atomic<uint64_t> tail = 0;
+  // Результат av_read_frame, на котором остановилось чтение
+  int read_result = 0;
+  std::thread thread;
+  std::atomic<int64_t> packets_count = 0;
+  std::atomic<int64_t> max_depth = 0;
+  std::atomic<int64_t> reader_stalls_count = 0;
+  std::atomic<int64_t> decoder_stalls_count = 0;
+};
+
+// Запускает поток упреждающего чтения входа
+void decoder_read_ahead_start(decoder_read_ahead_ctx **ctx_ref, AVFormatContext *format_ctx, size_t capacity);
+
+// Забирает следующий прочитанный пакет. Возвращает то же, что и av_read_frame.
+int decoder_read_ahead_read(decoder_read_ahead_ctx *ctx, AVPacket *packet);
+
+// Выдает счетчики очереди
+void decoder_read_ahead_get_stats(decoder_read_ahead_ctx *ctx, decoder_read_ahead_stats *stats);
+
+// Останавливает поток чтения и освобождает непрочитанные пакеты
+void decoder_read_ahead_stop(decoder_read_ahead_ctx **ctx_ref);
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_DECODER_DECODER_READ_AHEAD_HPP_
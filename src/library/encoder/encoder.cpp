@@ -207,29 +207,148 @@ bool build_streams_map(AVFormatContext *format_ctx,
     return true;
 }
 
-int encoder_init(void **ctx_ref, const char *path, std::map<int, encoder_stream_cfg> &streams) {
+// Выделяет память под буффер пула, учитывая количество выделений
+AVBufferRef *allocate_pool_buffer(void *opaque, size_t size) {
+    static_cast<encoder_stream_ctx *>(opaque)->frames_pool_allocations_count++;
+    return av_buffer_alloc(size);
+}
+
+// Создает пул буфферов плоскостей, рассчитанных на полный фрейм энкодера
+bool init_frames_pool(encoder_stream_ctx *stream_ctx) {
+    AVCodecContext *context = stream_ctx->codec_context;
+
+    if (context->frame_size <= 0
+        || av_samples_get_buffer_size(&stream_ctx->frames_pool_linesize,
+                                      context->channels,
+                                      context->frame_size,
+                                      context->sample_fmt,
+                                      0) < 0) {
+        return true;
+    }
+
+    stream_ctx->frames_pool = av_buffer_pool_init2(stream_ctx->frames_pool_linesize,
+                                                   stream_ctx,
+                                                   allocate_pool_buffer,
+                                                   nullptr);
+
+    return stream_ctx->frames_pool != nullptr;
+}
+
+// Заполняет фрейм буфферами из пула. Если фрейм в пул не помещается, выделяет память обычным способом.
+bool get_frame_buffer(encoder_stream_ctx *stream_ctx, AVFrame *frame) {
+    AVCodecContext *context = stream_ctx->codec_context;
+    int planes_count = av_sample_fmt_is_planar(context->sample_fmt) ? context->channels : 1;
+
+    if (stream_ctx->frames_pool == nullptr
+        || frame->nb_samples > context->frame_size
+        || planes_count > AV_NUM_DATA_POINTERS) {
+        return av_frame_get_buffer(frame, 0) >= 0;
+    }
+
+    for (int i = 0; i < planes_count; ++i) {
+        frame->buf[i] = av_buffer_pool_get(stream_ctx->frames_pool);
+
+        if (frame->buf[i] == nullptr) {
+            av_frame_unref(frame);
+            return false;
+        }
+
+        frame->data[i] = frame->buf[i]->data;
+    }
+
+    frame->extended_data = frame->data;
+    frame->linesize[0] = stream_ctx->frames_pool_linesize;
+    return true;
+}
+
+// Создает контексты потоков энкодера и пулы их фреймов
+int init_encoder_streams(void **ctx_ref,
+                         encoder_ctx *ctx,
+                         std::unordered_map<int, const AVCodec *> &codecs_map,
+                         std::unordered_map<int, AVCodecContext *> &codecs_contexts_map,
+                         std::unordered_map<int, AVStream *> &streams_map) {
+    ctx->streams_map = new std::unordered_map<int, encoder_stream_ctx *>;
+
+    for (const auto &item : codecs_map) {
+        const AVCodec *codec = codecs_map[item.first];
+        AVCodecContext *codec_context = codecs_contexts_map[item.first];
+        AVStream *stream = streams_map.contains(item.first) ? streams_map[item.first] : nullptr;
+        size_t index = ctx->streams_map->size();
+
+        (*ctx->streams_map)[item.first] = new encoder_stream_ctx{
+            index,
+            codec,
+            codec_context,
+            stream,
+            av_packet_alloc(),
+            av_frame_alloc(),
+        };
+        (*ctx->streams_map)[item.first]->tag = item.first;
+    }
+
+    *ctx_ref = ctx;
+
+    for (const auto &item : *ctx->streams_map) {
+        if (!init_frames_pool(item.second)) {
+            encoder_free(ctx_ref);
+            return ENCODER_CODECS_INITIALIZATION_ERROR;
+        }
+    }
+
+    return 0;
+}
+
+// Создает контекст формата вместе с потоками энкодеров
+int alloc_output_format(AVFormatContext **format_ctx_ref,
+                        const char *format_name,
+                        const char *path,
+                        std::map<int, encoder_stream_cfg> &streams,
+                        std::unordered_map<int, const AVCodec *> &codecs_map,
+                        std::unordered_map<int, AVCodecContext *> &codecs_contexts_map,
+                        std::unordered_map<int, AVStream *> &streams_map) {
     if (streams.empty()) {
         return ENCODER_STREAMS_LIST_EMPTY_ERROR;
     }
 
-    AVFormatContext *format_ctx;
-
-    if (avformat_alloc_output_context2(&format_ctx, nullptr, nullptr, path) < 0) {
+    if (avformat_alloc_output_context2(format_ctx_ref, nullptr, format_name, path) < 0) {
         return ENCODER_OUTPUT_STREAM_ERROR;
     }
 
+    if (!build_encoders_map(streams, codecs_map)
+        || !build_encoders_contexts_map(codecs_map, codecs_contexts_map, streams)
+        || !build_streams_map(*format_ctx_ref, codecs_map, codecs_contexts_map, streams_map)) {
+        avformat_free_context(*format_ctx_ref);
+        return ENCODER_CODECS_INITIALIZATION_ERROR;
+    }
+
+    return 0;
+}
+
+int encoder_init(void **ctx_ref,
+                 const char *path,
+                 std::map<int, encoder_stream_cfg> &streams,
+                 const AVIOInterruptCB *interrupt_callback) {
+    AVFormatContext *format_ctx;
     std::unordered_map<int, const AVCodec *> codecs_map;
     std::unordered_map<int, AVCodecContext *> codecs_contexts_map;
     std::unordered_map<int, AVStream *> streams_map;
+    int result = alloc_output_format(&format_ctx,
+                                     nullptr,
+                                     path,
+                                     streams,
+                                     codecs_map,
+                                     codecs_contexts_map,
+                                     streams_map);
+
+    if (result < 0) {
+        return result;
+    }
 
-    if (!build_encoders_map(streams, codecs_map)
-        || !build_encoders_contexts_map(codecs_map, codecs_contexts_map, streams)
-        || !build_streams_map(format_ctx, codecs_map, codecs_contexts_map, streams_map)) {
-        avformat_free_context(format_ctx);
-        return ENCODER_CODECS_INITIALIZATION_ERROR;
+    if (interrupt_callback != nullptr) {
+        format_ctx->interrupt_callback = *interrupt_callback;
     }
 
-    if (avio_open(&format_ctx->pb, path, AVIO_FLAG_WRITE) < 0) {
+    if (avio_open2(&format_ctx->pb, path, AVIO_FLAG_WRITE, interrupt_callback, nullptr) < 0) {
         avformat_free_context(format_ctx);
         return ENCODER_OUTPUT_STREAM_ERROR;
     }
@@ -241,26 +360,71 @@ int encoder_init(void **ctx_ref, const char *path, std::map<int, encoder_stream_
         return ENCODER_OUTPUT_STREAM_ERROR;
     }
 
-    auto encoder_streams_ctxs = new std::unordered_map<int, encoder_stream_ctx *>;
+    return init_encoder_streams(ctx_ref,
+                                new encoder_ctx{false, path, format_ctx},
+                                codecs_map,
+                                codecs_contexts_map,
+                                streams_map);
+}
 
-    for (const auto &item : codecs_map) {
-        const AVCodec *codec = codecs_map[item.first];
-        AVCodecContext *codec_context = codecs_contexts_map[item.first];
-        AVStream *stream = streams_map[item.first];
-        size_t index = encoder_streams_ctxs->size();
+int encoder_init_with_io(void **ctx_ref,
+                         const char *format_name,
+                         AVIOContext *io_ctx,
+                         std::map<int, encoder_stream_cfg> &streams) {
+    if (format_name == nullptr || io_ctx == nullptr) {
+        return ENCODER_OUTPUT_STREAM_ERROR;
+    }
 
-        (*encoder_streams_ctxs)[item.first] = new encoder_stream_ctx{
-            index,
-            codec,
-            codec_context,
-            stream,
-            av_packet_alloc(),
-            av_frame_alloc(),
-        };
+    AVFormatContext *format_ctx;
+    std::unordered_map<int, const AVCodec *> codecs_map;
+    std::unordered_map<int, AVCodecContext *> codecs_contexts_map;
+    std::unordered_map<int, AVStream *> streams_map;
+    int result = alloc_output_format(&format_ctx,
+                                     format_name,
+                                     nullptr,
+                                     streams,
+                                     codecs_map,
+                                     codecs_contexts_map,
+                                     streams_map);
+
+    if (result < 0) {
+        return result;
     }
 
-    *ctx_ref = new encoder_ctx{false, path, format_ctx, encoder_streams_ctxs};
-    return 0;
+    format_ctx->pb = io_ctx;
+    format_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+    if (avformat_write_header(format_ctx, nullptr) < 0) {
+        avformat_free_context(format_ctx);
+        return ENCODER_OUTPUT_STREAM_ERROR;
+    }
+
+    auto ctx = new encoder_ctx{false, nullptr, format_ctx};
+    ctx->custom_io = true;
+
+    return init_encoder_streams(ctx_ref, ctx, codecs_map, codecs_contexts_map, streams_map);
+}
+
+int encoder_init_with_packet_handler(void **ctx_ref,
+                                     std::map<int, encoder_stream_cfg> &streams,
+                                     const std::function<bool(int, AVPacket *)> &handle_packet) {
+    if (streams.empty()) {
+        return ENCODER_STREAMS_LIST_EMPTY_ERROR;
+    }
+
+    std::unordered_map<int, const AVCodec *> codecs_map;
+    std::unordered_map<int, AVCodecContext *> codecs_contexts_map;
+    std::unordered_map<int, AVStream *> streams_map;
+
+    if (!build_encoders_map(streams, codecs_map)
+        || !build_encoders_contexts_map(codecs_map, codecs_contexts_map, streams)) {
+        return ENCODER_CODECS_INITIALIZATION_ERROR;
+    }
+
+    auto ctx = new encoder_ctx();
+    ctx->packet_handler = new std::function<bool(int, AVPacket *)>(handle_packet);
+
+    return init_encoder_streams(ctx_ref, ctx, codecs_map, codecs_contexts_map, streams_map);
 }
 
 int encoder_get_samples_count_per_frame(void *ctx_ref, int stream_tag) {
@@ -283,11 +447,28 @@ int encoder_get_bytes_per_sample_count(void *ctx_ref, int stream_tag) {
     return av_get_bytes_per_sample((*casted_ctx->streams_map)[stream_tag]->codec_context->sample_fmt);
 }
 
-int encode_frame(AVCodecContext *context,
-                 AVFormatContext *format_ctx,
-                 AVFrame *frame,
-                 size_t stream_index,
-                 AVPacket *packet) {
+// Записывает пакет в файл или передает его в обработчик
+int write_packet(encoder_ctx *ctx, encoder_stream_ctx *stream_ctx, AVPacket *packet) {
+    packet->stream_index = (int) stream_ctx->index;
+
+    if (ctx->packet_handler != nullptr) {
+        bool handled = (*ctx->packet_handler)(stream_ctx->tag, packet);
+        av_packet_unref(packet);
+        return handled ? 0 : ENCODER_UNEXPECTED_ERROR;
+    }
+
+    if (av_interleaved_write_frame(ctx->format_ctx, packet) < 0) {
+        av_packet_unref(packet);
+        return ENCODER_UNEXPECTED_ERROR;
+    }
+
+    return 0;
+}
+
+int encode_frame(encoder_ctx *ctx, encoder_stream_ctx *stream_ctx, AVFrame *frame) {
+    AVCodecContext *context = stream_ctx->codec_context;
+    AVPacket *packet = stream_ctx->packet;
+
     if (avcodec_send_frame(context, frame) < 0) {
         if (frame != nullptr) {
             av_frame_unref(frame);
@@ -309,11 +490,7 @@ int encode_frame(AVCodecContext *context,
             return res == AVERROR_EOF || res == AVERROR(EAGAIN) ? 0 : ENCODER_UNEXPECTED_ERROR;
         }
 
-        packet->stream_index = (int) stream_index;
-
-        if (av_interleaved_write_frame(format_ctx, packet) < 0) {
-            av_packet_unref(packet);
-
+        if (write_packet(ctx, stream_ctx, packet) < 0) {
             if (frame != nullptr) {
                 av_frame_unref(frame);
             }
@@ -330,24 +507,183 @@ int encode_frame(AVCodecContext *context,
 int encoder_encode(void *ctx_ref, int stream_tag, uint8_t **data, size_t data_len) {
     auto casted_ctx = static_cast<encoder_ctx *>(ctx_ref);
     auto stream_ctx = (*casted_ctx->streams_map)[stream_tag];
-    int bytes_per_sample = av_get_bytes_per_sample(stream_ctx->codec_context->sample_fmt);
+    AVSampleFormat sample_fmt = stream_ctx->codec_context->sample_fmt;
+    int bytes_per_sample = av_get_bytes_per_sample(sample_fmt);
+    int planes_count = av_sample_fmt_is_planar(sample_fmt) ? stream_ctx->codec_context->channels : 1;
 
     stream_ctx->frame->nb_samples = (int) data_len / bytes_per_sample;
-    stream_ctx->frame->format = stream_ctx->codec_context->sample_fmt;
+    stream_ctx->frame->format = sample_fmt;
     stream_ctx->frame->channel_layout = stream_ctx->codec_context->channel_layout;
     stream_ctx->frame->sample_rate = stream_ctx->codec_context->sample_rate;
+    stream_ctx->frame->pts = stream_ctx->next_pts;
+    stream_ctx->next_pts += stream_ctx->frame->nb_samples;
 
-    if (av_frame_get_buffer(stream_ctx->frame, 0) < 0) {
+    if (!get_frame_buffer(stream_ctx, stream_ctx->frame)) {
         return ENCODER_UNEXPECTED_ERROR;
     }
 
-    memcpy(stream_ctx->frame->data, data, stream_ctx->codec_context->channels * sizeof(uint8_t*));
+    // Данные копируются в буффер фрейма, чтобы энкодер не зависел от времени жизни памяти вызывающего
+    for (int i = 0; i < planes_count; ++i) {
+        memcpy(stream_ctx->frame->extended_data[i], data[i], data_len);
+    }
+
+    return encode_frame(casted_ctx, stream_ctx, stream_ctx->frame);
+}
+
+int encoder_write_packet(void *ctx_ref, int stream_tag, AVPacket *packet) {
+    auto casted_ctx = static_cast<encoder_ctx *>(ctx_ref);
+
+    if (!casted_ctx->streams_map->contains(stream_tag)) {
+        return ENCODER_STREAM_NOT_FOUND;
+    }
+
+    return write_packet(casted_ctx, (*casted_ctx->streams_map)[stream_tag], packet);
+}
+
+// Сдвигает указатели на плоскости на указанное количество семплов
+void offset_planes(uint8_t **planes, AVCodecContext *context, int samples_offset) {
+    bool is_planar = av_sample_fmt_is_planar(context->sample_fmt);
+    int planes_count = is_planar ? context->channels : 1;
+    int step = av_get_bytes_per_sample(context->sample_fmt) * (is_planar ? 1 : context->channels);
+
+    for (int i = 0; i < planes_count; ++i) {
+        planes[i] += samples_offset * step;
+    }
+}
+
+// Выделяет фрейм для записи семплов и переносит в него еще не закодированный хвост
+bool reallocate_pending_frame(encoder_stream_ctx *stream_ctx, int need_samples_count) {
+    AVCodecContext *context = stream_ctx->codec_context;
+    int frame_size = context->frame_size > 0 ? context->frame_size : need_samples_count;
+    int capacity = (need_samples_count + frame_size) / frame_size * frame_size;
+    AVFrame *frame = av_frame_alloc();
+
+    if (frame == nullptr) {
+        return false;
+    }
+
+    frame->nb_samples = capacity;
+    frame->format = context->sample_fmt;
+    frame->channel_layout = context->channel_layout;
+    frame->sample_rate = context->sample_rate;
+
+    if (av_frame_get_buffer(frame, 0) < 0) {
+        av_frame_free(&frame);
+        return false;
+    }
+
+    if (stream_ctx->pending_frame != nullptr) {
+        av_samples_copy(frame->extended_data,
+                        stream_ctx->pending_frame->extended_data,
+                        0,
+                        stream_ctx->pending_offset,
+                        stream_ctx->pending_samples,
+                        context->channels,
+                        context->sample_fmt);
+        av_frame_free(&stream_ctx->pending_frame);
+    }
 
-    return encode_frame(stream_ctx->codec_context,
-                        casted_ctx->format_ctx,
-                        stream_ctx->frame,
-                        stream_ctx->index,
-                        stream_ctx->packet);
+    stream_ctx->pending_frame = frame;
+    stream_ctx->pending_capacity = capacity;
+    stream_ctx->pending_offset = 0;
+    return true;
+}
+
+// Кодирует отложенные семплы, начиная с начала хвоста, без копирования данных
+int encode_pending_samples(encoder_ctx *ctx, encoder_stream_ctx *stream_ctx, int samples_count) {
+    AVFrame *frame = stream_ctx->frame;
+
+    if (av_frame_ref(frame, stream_ctx->pending_frame) < 0) {
+        return ENCODER_UNEXPECTED_ERROR;
+    }
+
+    offset_planes(frame->extended_data, stream_ctx->codec_context, stream_ctx->pending_offset);
+
+    for (int i = 0; i < AV_NUM_DATA_POINTERS && i < stream_ctx->codec_context->channels; ++i) {
+        frame->data[i] = frame->extended_data[i];
+    }
+
+    frame->nb_samples = samples_count;
+    frame->pts = stream_ctx->next_pts;
+    stream_ctx->next_pts += samples_count;
+    stream_ctx->pending_offset += samples_count;
+    stream_ctx->pending_samples -= samples_count;
+
+    return encode_frame(ctx, stream_ctx, frame);
+}
+
+uint8_t **encoder_get_writable_planes(void *ctx_ref, int stream_tag, int samples_count) {
+    auto casted_ctx = static_cast<encoder_ctx *>(ctx_ref);
+
+    if (!casted_ctx->streams_map->contains(stream_tag)) {
+        return nullptr;
+    }
+
+    auto stream_ctx = (*casted_ctx->streams_map)[stream_tag];
+    AVCodecContext *context = stream_ctx->codec_context;
+    int need_samples_count = stream_ctx->pending_samples + samples_count;
+
+    // Хвост переносится в начало фрейма только когда места за ним не хватает,
+    // а новый буффер выделяется лишь если энкодер все еще ссылается на текущий.
+    if (stream_ctx->pending_frame == nullptr
+        || !av_frame_is_writable(stream_ctx->pending_frame)
+        || need_samples_count > stream_ctx->pending_capacity) {
+        if (!reallocate_pending_frame(stream_ctx, need_samples_count)) {
+            return nullptr;
+        }
+    } else if (stream_ctx->pending_offset + need_samples_count > stream_ctx->pending_capacity) {
+        av_samples_copy(stream_ctx->pending_frame->extended_data,
+                        stream_ctx->pending_frame->extended_data,
+                        0,
+                        stream_ctx->pending_offset,
+                        stream_ctx->pending_samples,
+                        context->channels,
+                        context->sample_fmt);
+        stream_ctx->pending_offset = 0;
+    }
+
+    if (stream_ctx->lent_planes == nullptr) {
+        stream_ctx->lent_planes = new uint8_t *[context->channels];
+    }
+
+    memcpy(stream_ctx->lent_planes,
+           stream_ctx->pending_frame->extended_data,
+           context->channels * sizeof(uint8_t *));
+    offset_planes(stream_ctx->lent_planes,
+                  context,
+                  stream_ctx->pending_offset + stream_ctx->pending_samples);
+
+    return stream_ctx->lent_planes;
+}
+
+int encoder_commit_written_samples(void *ctx_ref, int stream_tag, int samples_count) {
+    auto casted_ctx = static_cast<encoder_ctx *>(ctx_ref);
+
+    if (!casted_ctx->streams_map->contains(stream_tag)) {
+        return ENCODER_STREAM_NOT_FOUND;
+    }
+
+    auto stream_ctx = (*casted_ctx->streams_map)[stream_tag];
+    int frame_size = stream_ctx->codec_context->frame_size;
+    stream_ctx->pending_samples += samples_count;
+
+    if (frame_size <= 0) {
+        frame_size = stream_ctx->pending_samples;
+    }
+
+    while (stream_ctx->pending_samples > 0 && stream_ctx->pending_samples >= frame_size) {
+        int result = encode_pending_samples(casted_ctx, stream_ctx, frame_size);
+
+        if (result < 0) {
+            return result;
+        }
+    }
+
+    if (stream_ctx->pending_samples == 0) {
+        stream_ctx->pending_offset = 0;
+    }
+
+    return 0;
 }
 
 int encoder_finish_encode(void *ctx_ref) {
@@ -355,18 +691,24 @@ int encoder_finish_encode(void *ctx_ref) {
 
     for (const auto &item : *casted_ctx->streams_map) {
         auto stream_ctx = (*casted_ctx->streams_map)[item.first];
-        int result = encode_frame(stream_ctx->codec_context,
-                                  casted_ctx->format_ctx,
-                                  nullptr,
-                                  stream_ctx->index,
-                                  stream_ctx->packet);
+
+        // Дописываем хвост, оставшийся после записи через encoder_get_writable_planes
+        if (stream_ctx->pending_samples > 0) {
+            int result = encode_pending_samples(casted_ctx, stream_ctx, stream_ctx->pending_samples);
+
+            if (result < 0) {
+                return result;
+            }
+        }
+
+        int result = encode_frame(casted_ctx, stream_ctx, nullptr);
 
         if (result < 0) {
             return result;
         }
     }
 
-    if (av_write_trailer(casted_ctx->format_ctx) >= 0) {
+    if (casted_ctx->format_ctx == nullptr || av_write_trailer(casted_ctx->format_ctx) >= 0) {
         casted_ctx->encode_finished = true;
         return 0;
     }
@@ -379,16 +721,26 @@ void encoder_free(void **ctx_ref) {
 
     for (const auto &item : *casted_ctx->streams_map) {
         av_frame_free(&(item.second->frame));
+        av_buffer_pool_uninit(&(item.second->frames_pool));
+        av_frame_free(&(item.second->pending_frame));
+        delete[] item.second->lent_planes;
         av_packet_free(&(item.second->packet));
         avcodec_free_context(&item.second->codec_context);
         delete item.second;
     }
 
     delete casted_ctx->streams_map;
-    avio_closep(&casted_ctx->format_ctx->pb);
-    avformat_free_context(casted_ctx->format_ctx);
+    delete casted_ctx->packet_handler;
+
+    if (casted_ctx->format_ctx != nullptr) {
+        if (!casted_ctx->custom_io) {
+            avio_closep(&casted_ctx->format_ctx->pb);
+        }
+
+        avformat_free_context(casted_ctx->format_ctx);
+    }
 
-    if (!casted_ctx->encode_finished) {
+    if (!casted_ctx->encode_finished && casted_ctx->encoding_file_path != nullptr) {
         std::remove(casted_ctx->encoding_file_path);
     }
 
@@ -3,13 +3,35 @@
 
 extern "C" {
 #include <libavcodec/avcodec.h>
+#include <libavformat/avio.h>
 }
 
 #include "encoder_stream_config.hpp"
 #include <map>
-
-// Инициализирует энкодер
-int encoder_init(void** ctx_ref, const char* path, std::map<int, encoder_stream_cfg>& streams);
+#include <functional>
+
+// Инициализирует энкодер. Если передан обработчик прерывания, то блокирующая запись прерывается,
+// как только он вернет не 0.
+int encoder_init(void** ctx_ref,
+                 const char* path,
+                 std::map<int, encoder_stream_cfg>& streams,
+                 const AVIOInterruptCB *interrupt_callback = nullptr);
+
+// Инициализирует энкодер, записывающий контейнер указанного формата в AVIOContext вызывающего.
+// Контекст должен оставаться доступным до освобождения энкодера и не закрывается им.
+int encoder_init_with_io(void **ctx_ref,
+                         const char *format_name,
+                         AVIOContext *io_ctx,
+                         std::map<int, encoder_stream_cfg> &streams);
+
+// Инициализирует энкодер, передающий закодированные пакеты в обработчик вместо записи в файл.
+// pts пакетов выражены в семплах потока. Обработчик может забрать данные пакета через av_packet_move_ref.
+int encoder_init_with_packet_handler(void **ctx_ref,
+                                     std::map<int, encoder_stream_cfg> &streams,
+                                     const std::function<bool(int, AVPacket *)> &handle_packet);
+
+// Записывает уже закодированный пакет потока, забирая его данные
+int encoder_write_packet(void *ctx_ref, int stream_tag, AVPacket *packet);
 
 // Выдает количество семплов во фрейме
 int encoder_get_samples_count_per_frame(void *ctx_ref, int stream_tag);
@@ -20,6 +42,13 @@ int encoder_get_bytes_per_sample_count(void *ctx_ref, int stream_tag);
 // Кодирует указанные данные потока
 int encoder_encode(void *ctx_ref, int stream_tag, uint8_t** data, size_t data_len);
 
+// Выдает указатели на плоскости фрейма энкодера, в которые можно записать указанное количество семплов.
+// Указатели действительны до следующего вызова encoder_commit_written_samples.
+uint8_t **encoder_get_writable_planes(void *ctx_ref, int stream_tag, int samples_count);
+
+// Подтверждает запись семплов в плоскости фрейма и кодирует все заполненные фреймы
+int encoder_commit_written_samples(void *ctx_ref, int stream_tag, int samples_count);
+
 // Заканчивает кодирование потока
 int encoder_finish_encode(void *ctx_ref);
 
@@ -6,6 +6,7 @@ extern "C" {
 }
 
 #include <unordered_map>
+#include <functional>
 
 struct encoder_stream_ctx {
   size_t index = 0;
@@ -14,6 +15,17 @@ struct encoder_stream_ctx {
   AVStream *stream = nullptr;
   AVPacket *packet = nullptr;
   AVFrame *frame = nullptr;
+  AVBufferPool *frames_pool = nullptr;
+  int frames_pool_linesize = 0;
+  int64_t frames_pool_allocations_count = 0;
+  AVFrame *pending_frame = nullptr;
+  uint8_t **lent_planes = nullptr;
+  int pending_capacity = 0;
+  int pending_offset = 0;
+  int pending_samples = 0;
+  int tag = 0;
+  // pts следующего фрейма в семплах
+  int64_t next_pts = 0;
 };
 
 struct encoder_ctx {
@@ -21,6 +33,10 @@ struct encoder_ctx {
   const char *encoding_file_path = nullptr;
   AVFormatContext *format_ctx = nullptr;
   std::unordered_map<int, encoder_stream_ctx *>* streams_map = nullptr;
+  // Обработчик пакетов, заменяющий запись в файл
+  std::function<bool(int, AVPacket *)> *packet_handler = nullptr;
+  // AVIOContext записи принадлежит вызывающему и не закрывается энкодером
+  bool custom_io = false;
 };
 
 #endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_ENCODER_ENCODER_CONTEXT_HPP_
\ No newline at end of file
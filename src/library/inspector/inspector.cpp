@@ -2,12 +2,10 @@
 #include "inspector_errors.hpp"
 #include "../decoder/decoder.hpp"
 #include "../decoder/decoder_errors.hpp"
+#include "../scheduler/scheduler.hpp"
 
-int64_t inspector_get_audio_duration_in_us(const char *path) {
-    void *decoder_ctx;
-    std::unordered_set<AVMediaType> media_types{AVMEDIA_TYPE_AUDIO};
-    int decoder_result = decoder_init(&decoder_ctx, path, 0, 0, media_types);
-
+// Выдает длительность аудио-записи, для которой был инициализирован декодер
+int64_t get_audio_duration_in_us(int decoder_result, void *decoder_ctx) {
     if (decoder_result < 0) {
         switch (decoder_result) {
             case DECODER_UNSUPPORTED_MEDIA_TYPE_ERROR:
@@ -39,4 +37,22 @@ int64_t inspector_get_audio_duration_in_us(const char *path) {
 
     return last_result == DECODER_END_OF_STREAM_ERROR ?
            last_pts : INSPECTOR_UNEXPECTED_ERROR;
-}
\ No newline at end of file
+}
+
+int64_t inspector_get_audio_duration_in_us(const char *path) {
+    scheduler_slot_guard slot;
+    void *decoder_ctx;
+    std::unordered_set<AVMediaType> media_types{AVMEDIA_TYPE_AUDIO};
+    int decoder_result = decoder_init(&decoder_ctx, path, 0, 0, media_types);
+
+    return get_audio_duration_in_us(decoder_result, decoder_ctx);
+}
+
+int64_t inspector_get_audio_duration_in_us_from_memory(const uint8_t *data, size_t size) {
+    scheduler_slot_guard slot;
+    void *decoder_ctx;
+    std::unordered_set<AVMediaType> media_types{AVMEDIA_TYPE_AUDIO};
+    int decoder_result = decoder_init_from_memory(&decoder_ctx, data, size, 0, 0, media_types);
+
+    return get_audio_duration_in_us(decoder_result, decoder_ctx);
+}
@@ -1,10 +1,15 @@
 #ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_INSPECTOR_INSPECTOR_HPP_
 #define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_INSPECTOR_INSPECTOR_HPP_
 
+#include <cstddef>
 #include <cstdint>
 
 // Выдает длительность аудио-записи в микросекундах
 extern "C"
 int64_t inspector_get_audio_duration_in_us(const char *path);
 
+// Выдает длительность аудио-записи, находящейся в памяти, в микросекундах
+extern "C"
+int64_t inspector_get_audio_duration_in_us_from_memory(const uint8_t *data, size_t size);
+
 #endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_INSPECTOR_INSPECTOR_HPP_
\ No newline at end of file
@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/mem.h>
+#include <libavutil/error.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <climits>
+}
+
+#include "io.hpp"
+#include "io_context.hpp"
+#include "io_errors.hpp"
+#include "../scheduler/scheduler.hpp"
+
+// Размер буффера AVIOContext
+#define IO_BUFFER_SIZE (64 * 1024)
+
+// Читает данные источника в памяти
+int read_memory_source(void *opaque, uint8_t *buf, int buf_size) {
+    auto source = static_cast<io_source_ctx *>(opaque);
+    std::size_t remained = source->size - source->position;
+
+    if (remained == 0) {
+        return AVERROR_EOF;
+    }
+
+    auto count = std::min(remained, static_cast<std::size_t>(buf_size));
+    memcpy(buf, source->data + source->position, count);
+    source->position += count;
+
+    return static_cast<int>(count);
+}
+
+// Перемещает позицию чтения источника в памяти
+int64_t seek_memory_source(void *opaque, int64_t offset, int whence) {
+    auto source = static_cast<io_source_ctx *>(opaque);
+    int64_t position;
+
+    switch (whence & ~AVSEEK_FORCE) {
+        case AVSEEK_SIZE:return static_cast<int64_t>(source->size);
+        case SEEK_SET:position = offset;
+            break;
+        case SEEK_CUR:position = static_cast<int64_t>(source->position) + offset;
+            break;
+        case SEEK_END:position = static_cast<int64_t>(source->size) + offset;
+            break;
+        default:return AVERROR(EINVAL);
+    }
+
+    if (position < 0 || position > static_cast<int64_t>(source->size)) {
+        return AVERROR(EINVAL);
+    }
+
+    source->position = static_cast<std::size_t>(position);
+    return position;
+}
+
+// Ожидает готовности дескриптора к чтению или записи. Пока канал пуст или переполнен, слот планировщика
+// отдается другим задачам, чтобы поток из живой записи не занимал его бесконечно.
+void wait_for_fd(int fd, short events) {
+    pollfd poll_fd{fd, events, 0};
+
+    if (poll(&poll_fd, 1, 0) != 0) {
+        return;
+    }
+
+    scheduler_suspend();
+
+    while (poll(&poll_fd, 1, -1) < 0 && errno == EINTR) {
+    }
+
+    scheduler_resume();
+}
+
+// Читает данные из дескриптора, ожидая их появления
+int read_fd_source(void *opaque, uint8_t *buf, int buf_size) {
+    auto source = static_cast<io_source_ctx *>(opaque);
+
+    while (true) {
+        wait_for_fd(source->fd, POLLIN);
+        ssize_t count = read(source->fd, buf, buf_size);
+
+        if (count > 0) {
+            return static_cast<int>(count);
+        } else if (count == 0) {
+            return AVERROR_EOF;
+        } else if (errno != EINTR) {
+            return AVERROR(errno);
+        }
+    }
+}
+
+// Освобождает источник вместе с отображением файла
+void release_source(io_source_ctx *source) {
+    if (source->mapping != nullptr) {
+        munmap(source->mapping, source->mapping_size);
+    }
+
+    delete source;
+}
+
+// Создает AVIOContext поверх подготовленного источника
+int open_source(AVIOContext **io_ctx_ref,
+                io_source_ctx *source,
+                int (*read_packet)(void *, uint8_t *, int),
+                int64_t (*seek)(void *, int64_t, int)) {
+    auto buffer = static_cast<unsigned char *>(av_malloc(IO_BUFFER_SIZE));
+
+    if (buffer == nullptr) {
+        release_source(source);
+        return IO_ALLOCATION_ERROR;
+    }
+
+    AVIOContext *io_ctx = avio_alloc_context(buffer, IO_BUFFER_SIZE, 0, source, read_packet, nullptr, seek);
+
+    if (io_ctx == nullptr) {
+        av_free(buffer);
+        release_source(source);
+        return IO_ALLOCATION_ERROR;
+    }
+
+    *io_ctx_ref = io_ctx;
+    return 0;
+}
+
+int io_open_memory_input(AVIOContext **io_ctx_ref, const uint8_t *data, std::size_t size) {
+    if (data == nullptr && size != 0) {
+        return IO_INVALID_SOURCE_ERROR;
+    }
+
+    return open_source(io_ctx_ref,
+                       new io_source_ctx{data, size, 0},
+                       read_memory_source,
+                       seek_memory_source);
+}
+
+int io_open_mapped_file_input(AVIOContext **io_ctx_ref, const char *path) {
+    if (path == nullptr) {
+        return IO_INVALID_SOURCE_ERROR;
+    }
+
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        return IO_FILE_OPENING_ERROR;
+    }
+
+    struct stat file_stat{};
+
+    if (fstat(fd, &file_stat) < 0 || !S_ISREG(file_stat.st_mode)) {
+        close(fd);
+        return IO_FILE_OPENING_ERROR;
+    }
+
+    auto source = new io_source_ctx{nullptr, static_cast<std::size_t>(file_stat.st_size), 0};
+
+    // Пустой файл отобразить нельзя, он читается как пустой буффер
+    if (source->size > 0) {
+        void *mapping = mmap(nullptr, source->size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            delete source;
+            return IO_FILE_OPENING_ERROR;
+        }
+
+        madvise(mapping, source->size, MADV_SEQUENTIAL);
+        madvise(mapping, source->size, MADV_WILLNEED);
+
+        source->data = static_cast<const uint8_t *>(mapping);
+        source->mapping = mapping;
+        source->mapping_size = source->size;
+    }
+
+    close(fd);
+    return open_source(io_ctx_ref, source, read_memory_source, seek_memory_source);
+}
+
+// Передает данные записи в обработчик
+int write_callback_sink(void *opaque, uint8_t *buf, int buf_size) {
+    auto sink = static_cast<io_sink_ctx *>(opaque);
+
+    if (!(*sink->write_data)(buf, static_cast<std::size_t>(buf_size))) {
+        return AVERROR_EXTERNAL;
+    }
+
+    return buf_size;
+}
+
+// Записывает данные в текущую позицию буффера в памяти, увеличивая его геометрически
+int write_memory_sink(void *opaque, uint8_t *buf, int buf_size) {
+    auto sink = static_cast<io_sink_ctx *>(opaque);
+    std::size_t required = sink->position + static_cast<std::size_t>(buf_size);
+
+    if (required > sink->capacity) {
+        std::size_t new_capacity = std::max<std::size_t>(sink->capacity, IO_BUFFER_SIZE);
+
+        while (new_capacity < required) {
+            new_capacity *= 2;
+        }
+
+        auto data = static_cast<uint8_t *>(av_realloc(sink->data, new_capacity));
+
+        if (data == nullptr) {
+            return AVERROR(ENOMEM);
+        }
+
+        sink->data = data;
+        sink->capacity = new_capacity;
+    }
+
+    // Перемотка за конец данных оставляет пропуск, который заполняется нулями
+    if (sink->position > sink->size) {
+        memset(sink->data + sink->size, 0, sink->position - sink->size);
+    }
+
+    memcpy(sink->data + sink->position, buf, buf_size);
+    sink->position = required;
+    sink->size = std::max(sink->size, required);
+
+    return buf_size;
+}
+
+// Перемещает позицию записи буффера в памяти
+int64_t seek_memory_sink(void *opaque, int64_t offset, int whence) {
+    auto sink = static_cast<io_sink_ctx *>(opaque);
+    int64_t position;
+
+    switch (whence & ~AVSEEK_FORCE) {
+        case AVSEEK_SIZE:return static_cast<int64_t>(sink->size);
+        case SEEK_SET:position = offset;
+            break;
+        case SEEK_CUR:position = static_cast<int64_t>(sink->position) + offset;
+            break;
+        case SEEK_END:position = static_cast<int64_t>(sink->size) + offset;
+            break;
+        default:return AVERROR(EINVAL);
+    }
+
+    if (position < 0) {
+        return AVERROR(EINVAL);
+    }
+
+    sink->position = static_cast<std::size_t>(position);
+    return position;
+}
+
+// Освобождает приемник вместе с накопленными данными
+void release_sink(io_sink_ctx *sink) {
+    delete sink->write_data;
+    av_free(sink->data);
+    delete sink;
+}
+
+// Создает AVIOContext записи поверх подготовленного приемника
+int open_sink(AVIOContext **io_ctx_ref,
+              io_sink_ctx *sink,
+              int buffer_size,
+              int (*write_packet)(void *, uint8_t *, int),
+              int64_t (*seek)(void *, int64_t, int)) {
+    if (buffer_size < 0) {
+        release_sink(sink);
+        return IO_INVALID_SINK_ERROR;
+    } else if (buffer_size == 0) {
+        buffer_size = IO_BUFFER_SIZE;
+    }
+
+    auto buffer = static_cast<unsigned char *>(av_malloc(buffer_size));
+
+    if (buffer == nullptr) {
+        release_sink(sink);
+        return IO_ALLOCATION_ERROR;
+    }
+
+    AVIOContext *io_ctx = avio_alloc_context(buffer, buffer_size, 1, sink, nullptr, write_packet, seek);
+
+    if (io_ctx == nullptr) {
+        av_free(buffer);
+        release_sink(sink);
+        return IO_ALLOCATION_ERROR;
+    }
+
+    *io_ctx_ref = io_ctx;
+    return 0;
+}
+
+int io_open_callback_output(AVIOContext **io_ctx_ref,
+                            const std::function<bool(const uint8_t *, std::size_t)> &write_data,
+                            int buffer_size) {
+    if (!write_data) {
+        return IO_INVALID_SINK_ERROR;
+    }
+
+    auto sink = new io_sink_ctx();
+    sink->write_data = new std::function<bool(const uint8_t *, std::size_t)>(write_data);
+
+    return open_sink(io_ctx_ref, sink, buffer_size, write_callback_sink, nullptr);
+}
+
+int io_open_fd_output(AVIOContext **io_ctx_ref, int fd, int buffer_size) {
+    if (fd < 0) {
+        return IO_INVALID_SINK_ERROR;
+    }
+
+    return io_open_callback_output(io_ctx_ref, [fd](const uint8_t *data, std::size_t size) {
+      while (size > 0) {
+          // Готовый к записи канал гарантированно принимает PIPE_BUF байт без блокировки
+          wait_for_fd(fd, POLLOUT);
+          ssize_t count = write(fd, data, std::min<std::size_t>(size, PIPE_BUF));
+
+          if (count < 0 && errno == EINTR) {
+              continue;
+          } else if (count <= 0) {
+              return false;
+          }
+
+          data += count;
+          size -= static_cast<std::size_t>(count);
+      }
+
+      return true;
+    }, buffer_size);
+}
+
+int io_open_memory_output(AVIOContext **io_ctx_ref, int buffer_size) {
+    return open_sink(io_ctx_ref, new io_sink_ctx(), buffer_size, write_memory_sink, seek_memory_sink);
+}
+
+int io_take_memory_output(AVIOContext *io_ctx, uint8_t **data_ref, std::size_t *size_ref) {
+    auto sink = static_cast<io_sink_ctx *>(io_ctx->opaque);
+
+    if (sink->write_data != nullptr) {
+        return IO_INVALID_SINK_ERROR;
+    }
+
+    avio_flush(io_ctx);
+
+    if (io_ctx->error < 0) {
+        return IO_ALLOCATION_ERROR;
+    }
+
+    *data_ref = sink->data;
+    *size_ref = sink->size;
+    *sink = io_sink_ctx();
+
+    return 0;
+}
+
+void io_free_output(AVIOContext **io_ctx_ref) {
+    if (*io_ctx_ref == nullptr) {
+        return;
+    }
+
+    release_sink(static_cast<io_sink_ctx *>((*io_ctx_ref)->opaque));
+    av_freep(&(*io_ctx_ref)->buffer);
+    avio_context_free(io_ctx_ref);
+}
+
+int io_open_fd_input(AVIOContext **io_ctx_ref, int fd) {
+    if (fd < 0) {
+        return IO_INVALID_SOURCE_ERROR;
+    }
+
+    auto source = new io_source_ctx();
+    source->fd = fd;
+
+    return open_source(io_ctx_ref, source, read_fd_source, nullptr);
+}
+
+void io_free(AVIOContext **io_ctx_ref) {
+    if (*io_ctx_ref == nullptr) {
+        return;
+    }
+
+    release_source(static_cast<io_source_ctx *>((*io_ctx_ref)->opaque));
+    av_freep(&(*io_ctx_ref)->buffer);
+    avio_context_free(io_ctx_ref);
+}
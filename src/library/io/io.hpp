@@ -0,0 +1,47 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_IO_IO_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_IO_IO_HPP_
+
+extern "C" {
+#include <libavformat/avio.h>
+}
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Создает AVIOContext для чтения из памяти вызывающего. Память не копируется
+// и должна оставаться доступной до освобождения контекста.
+int io_open_memory_input(AVIOContext **io_ctx_ref, const uint8_t *data, std::size_t size);
+
+// Создает AVIOContext для чтения файла, отображенного в память.
+// Перемотка сводится к смещению указателя, а ядру сообщается о последовательном чтении.
+int io_open_mapped_file_input(AVIOContext **io_ctx_ref, const char *path);
+
+// Создает AVIOContext для последовательного чтения из файлового дескриптора, например из канала или сокета.
+// Перемотка не поддерживается, дескриптор не закрывается при освобождении контекста.
+int io_open_fd_input(AVIOContext **io_ctx_ref, int fd);
+
+// Освобождает AVIOContext, созданный функциями io_open_*
+void io_free(AVIOContext **io_ctx_ref);
+
+// Создает AVIOContext записи, передающий данные в обработчик по мере заполнения буффера.
+// Обработчик возвращает false, чтобы прервать запись. При нулевом размере буффера используется размер по умолчанию.
+int io_open_callback_output(AVIOContext **io_ctx_ref,
+                            const std::function<bool(const uint8_t *, std::size_t)> &write_data,
+                            int buffer_size);
+
+// Создает AVIOContext записи в растущий буффер в памяти. Поддерживает перемотку.
+int io_open_memory_output(AVIOContext **io_ctx_ref, int buffer_size);
+
+// Сбрасывает буффер записи и забирает накопленные в памяти данные.
+// Данные освобождаются через av_free, контекст после этого остается пустым.
+int io_take_memory_output(AVIOContext *io_ctx, uint8_t **data_ref, std::size_t *size_ref);
+
+// Создает AVIOContext последовательной записи в файловый дескриптор.
+// Дескриптор не закрывается при освобождении контекста.
+int io_open_fd_output(AVIOContext **io_ctx_ref, int fd, int buffer_size);
+
+// Освобождает AVIOContext, созданный функциями io_open_*_output
+void io_free_output(AVIOContext **io_ctx_ref);
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_IO_IO_HPP_
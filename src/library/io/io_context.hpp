@@ -0,0 +1,29 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_IO_IO_CONTEXT_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_IO_IO_CONTEXT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Источник данных для пользовательского AVIOContext
+struct io_source_ctx {
+  const uint8_t *data = nullptr;
+  std::size_t size = 0;
+  std::size_t position = 0;
+  void *mapping = nullptr;
+  std::size_t mapping_size = 0;
+  // Дескриптор, из которого читаются данные, -1 для источников в памяти
+  int fd = -1;
+};
+
+// Приемник данных для пользовательского AVIOContext записи.
+// Данные передаются в обработчик или накапливаются в памяти, если обработчика нет.
+struct io_sink_ctx {
+  std::function<bool(const uint8_t *, std::size_t)> *write_data = nullptr;
+  uint8_t *data = nullptr;
+  std::size_t size = 0;
+  std::size_t capacity = 0;
+  std::size_t position = 0;
+};
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_IO_IO_CONTEXT_HPP_
@@ -0,0 +1,9 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_IO_IO_ERRORS_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_IO_IO_ERRORS_HPP_
+
+#define IO_INVALID_SOURCE_ERROR (-1)
+#define IO_ALLOCATION_ERROR (-2)
+#define IO_FILE_OPENING_ERROR (-3)
+#define IO_INVALID_SINK_ERROR (-4)
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_IO_IO_ERRORS_HPP_
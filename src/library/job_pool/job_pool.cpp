@@ -0,0 +1,149 @@
+#include <algorithm>
+
+#include "job_pool.hpp"
+#include "job_pool_context.hpp"
+#include "job_pool_errors.hpp"
+
+// Забирает задачу из своей очереди, а если она пуста, то крадет задачу из очереди другого потока
+bool take_job(job_pool_ctx *ctx, std::size_t worker_index, std::function<void()> *job) {
+    std::size_t workers_count = ctx->workers.size();
+    bool taken = false;
+
+    for (std::size_t i = 0; i < workers_count && !taken; ++i) {
+        job_pool_worker *worker = ctx->workers[(worker_index + i) % workers_count];
+        std::lock_guard<std::mutex> lock(worker->mutex);
+
+        if (worker->jobs.empty()) {
+            continue;
+        }
+
+        if (i == 0) {
+            *job = std::move(worker->jobs.back());
+            worker->jobs.pop_back();
+        } else {
+            *job = std::move(worker->jobs.front());
+            worker->jobs.pop_front();
+            ctx->steals_count++;
+        }
+
+        taken = true;
+    }
+
+    if (taken) {
+        std::lock_guard<std::mutex> lock(ctx->mutex);
+        ctx->pending_count--;
+    }
+
+    return taken;
+}
+
+// Выполняет задачи, пока пул не будет остановлен
+void run_worker(job_pool_ctx *ctx, std::size_t worker_index) {
+    std::function<void()> job;
+
+    while (true) {
+        if (take_job(ctx, worker_index, &job)) {
+            job();
+            job = nullptr;
+            ctx->executed_count++;
+
+            std::lock_guard<std::mutex> lock(ctx->mutex);
+
+            if (--ctx->unfinished_count == 0) {
+                ctx->jobs_done.notify_all();
+            }
+
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(ctx->mutex);
+        ctx->jobs_added.wait(lock, [ctx] { return ctx->stopping || ctx->pending_count > 0; });
+
+        if (ctx->stopping && ctx->pending_count == 0) {
+            return;
+        }
+    }
+}
+
+int job_pool_init(void **ctx_ref, int workers_count) {
+    if (workers_count < 0) {
+        return JOB_POOL_INVALID_WORKERS_COUNT_ERROR;
+    } else if (workers_count == 0) {
+        workers_count = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+    }
+
+    auto ctx = new job_pool_ctx();
+
+    for (int i = 0; i < workers_count; ++i) {
+        ctx->workers.push_back(new job_pool_worker());
+    }
+
+    for (int i = 0; i < workers_count; ++i) {
+        ctx->threads.emplace_back(run_worker, ctx, static_cast<std::size_t>(i));
+    }
+
+    *ctx_ref = ctx;
+    return 0;
+}
+
+int job_pool_submit(void *ctx_ref, const std::function<void()> &job) {
+    auto casted_ctx = static_cast<job_pool_ctx *>(ctx_ref);
+
+    {
+        std::lock_guard<std::mutex> lock(casted_ctx->mutex);
+
+        if (casted_ctx->stopping) {
+            return JOB_POOL_STOPPED_ERROR;
+        }
+
+        // Задачи раскладываются по очередям по кругу, дисбаланс выравнивается кражей
+        job_pool_worker *worker = casted_ctx->workers[casted_ctx->next_worker++ % casted_ctx->workers.size()];
+
+        {
+            std::lock_guard<std::mutex> worker_lock(worker->mutex);
+            worker->jobs.push_back(job);
+        }
+
+        casted_ctx->pending_count++;
+        casted_ctx->unfinished_count++;
+    }
+
+    casted_ctx->jobs_added.notify_one();
+    return 0;
+}
+
+void job_pool_wait(void *ctx_ref) {
+    auto casted_ctx = static_cast<job_pool_ctx *>(ctx_ref);
+    std::unique_lock<std::mutex> lock(casted_ctx->mutex);
+    casted_ctx->jobs_done.wait(lock, [casted_ctx] { return casted_ctx->unfinished_count == 0; });
+}
+
+void job_pool_get_stats(void *ctx_ref, job_pool_stats *stats) {
+    auto casted_ctx = static_cast<job_pool_ctx *>(ctx_ref);
+
+    stats->workers_count = static_cast<int32_t>(casted_ctx->workers.size());
+    stats->executed_jobs_count = casted_ctx->executed_count;
+    stats->steals_count = casted_ctx->steals_count;
+}
+
+void job_pool_free(void **ctx_ref) {
+    auto casted_ctx = static_cast<job_pool_ctx *>(*ctx_ref);
+
+    {
+        std::lock_guard<std::mutex> lock(casted_ctx->mutex);
+        casted_ctx->stopping = true;
+    }
+
+    casted_ctx->jobs_added.notify_all();
+
+    for (auto &thread : casted_ctx->threads) {
+        thread.join();
+    }
+
+    for (auto &worker : casted_ctx->workers) {
+        delete worker;
+    }
+
+    delete casted_ctx;
+    *ctx_ref = nullptr;
+}
@@ -0,0 +1,30 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_JOB_POOL_JOB_POOL_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_JOB_POOL_JOB_POOL_HPP_
+
+#include <cstdint>
+#include <functional>
+
+// Счетчики пула задач
+struct job_pool_stats {
+  int32_t workers_count;
+  int64_t executed_jobs_count;
+  // Сколько задач было взято из очередей других рабочих потоков
+  int64_t steals_count;
+};
+
+// Создает пул с указанным количеством рабочих потоков. При 0 потоков их количество выбирается по числу ядер.
+int job_pool_init(void **ctx_ref, int workers_count);
+
+// Добавляет задачу в очередь одного из рабочих потоков. Простаивающие потоки забирают задачи из чужих очередей.
+int job_pool_submit(void *ctx_ref, const std::function<void()> &job);
+
+// Ожидает выполнения всех добавленных задач
+void job_pool_wait(void *ctx_ref);
+
+// Выдает счетчики пула
+void job_pool_get_stats(void *ctx_ref, job_pool_stats *stats);
+
+// Дожидается выполнения оставшихся задач и освобождает пул
+void job_pool_free(void **ctx_ref);
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_JOB_POOL_JOB_POOL_HPP_
@@ -0,0 +1,34 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_JOB_POOL_JOB_POOL_CONTEXT_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_JOB_POOL_JOB_POOL_CONTEXT_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Собственная очередь задач рабочего потока. Владелец берет задачи с конца, остальные крадут с начала.
+struct job_pool_worker {
+  std::mutex mutex;
+  std::deque<std::function<void()>> jobs;
+};
+
+struct job_pool_ctx {
+  std::vector<job_pool_worker *> workers;
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable jobs_added;
+  std::condition_variable jobs_done;
+  // Задачи, лежащие в очередях рабочих потоков
+  int64_t pending_count = 0;
+  // Задачи, которые добавлены, но еще не выполнены
+  int64_t unfinished_count = 0;
+  std::size_t next_worker = 0;
+  bool stopping = false;
+  std::atomic<int64_t> executed_count{0};
+  std::atomic<int64_t> steals_count{0};
+};
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_JOB_POOL_JOB_POOL_CONTEXT_HPP_
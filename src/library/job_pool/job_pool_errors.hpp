@@ -0,0 +1,7 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_JOB_POOL_JOB_POOL_ERRORS_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_JOB_POOL_JOB_POOL_ERRORS_HPP_
+
+#define JOB_POOL_INVALID_WORKERS_COUNT_ERROR (-1)
+#define JOB_POOL_STOPPED_ERROR (-2)
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_JOB_POOL_JOB_POOL_ERRORS_HPP_
@@ -0,0 +1,199 @@
+#include <filesystem>
+
+#include "probe_cache.hpp"
+#include "probe_cache_context.hpp"
+
+// Выдает общий для процесса кэш
+probe_cache_ctx &get_probe_cache() {
+    static probe_cache_ctx cache;
+    return cache;
+}
+
+// Читает размер и время изменения файла
+bool read_source_key(const char *path, uint64_t *size, int64_t *mtime) {
+    std::error_code error;
+    auto file_size = std::filesystem::file_size(path, error);
+
+    if (error) {
+        return false;
+    }
+
+    auto write_time = std::filesystem::last_write_time(path, error);
+
+    if (error) {
+        return false;
+    }
+
+    *size = file_size;
+    *mtime = write_time.time_since_epoch().count();
+    return true;
+}
+
+// Удаляет запись кэша
+void free_probe_cache_entry(probe_cache_entry *entry) {
+    for (auto &stream : entry->streams) {
+        avcodec_parameters_free(&stream.codecpar);
+    }
+
+    delete entry;
+}
+
+// Удаляет запись из кэша. Вызывается под блокировкой.
+void erase_probe_cache_entry(probe_cache_ctx &cache, const std::string &path) {
+    auto item = cache.entries_map.find(path);
+
+    if (item == cache.entries_map.end()) {
+        return;
+    }
+
+    free_probe_cache_entry(*item->second);
+    cache.entries.erase(item->second);
+    cache.entries_map.erase(item);
+}
+
+// Удаляет давно не использованные записи сверх емкости. Вызывается под блокировкой.
+void trim_probe_cache(probe_cache_ctx &cache) {
+    while (cache.entries.size() > cache.capacity) {
+        erase_probe_cache_entry(cache, cache.entries.back()->path);
+    }
+}
+
+// Проверяет, что запись описывает те же потоки, что нашел демуксер при открытии файла
+bool is_entry_matches_streams(probe_cache_entry *entry, AVFormatContext *format_ctx) {
+    if (entry->streams.size() != format_ctx->nb_streams) {
+        return false;
+    }
+
+    for (unsigned int i = 0; i < format_ctx->nb_streams; ++i) {
+        AVCodecParameters *codecpar = format_ctx->streams[i]->codecpar;
+
+        if (codecpar->codec_type != entry->streams[i].codecpar->codec_type
+            || (codecpar->codec_id != AV_CODEC_ID_NONE && codecpar->codec_id != entry->streams[i].codecpar->codec_id)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool probe_cache_restore(const char *path, AVFormatContext *format_ctx) {
+    uint64_t source_size;
+    int64_t source_mtime;
+
+    if (path == nullptr || !read_source_key(path, &source_size, &source_mtime)) {
+        return false;
+    }
+
+    probe_cache_ctx &cache = get_probe_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    if (cache.capacity == 0) {
+        return false;
+    }
+
+    auto item = cache.entries_map.find(path);
+
+    if (item == cache.entries_map.end()) {
+        cache.misses_count++;
+        return false;
+    }
+
+    probe_cache_entry *entry = *item->second;
+
+    if (entry->source_size != source_size
+        || entry->source_mtime != source_mtime
+        || !is_entry_matches_streams(entry, format_ctx)) {
+        erase_probe_cache_entry(cache, path);
+        cache.misses_count++;
+        return false;
+    }
+
+    for (unsigned int i = 0; i < format_ctx->nb_streams; ++i) {
+        AVStream *stream = format_ctx->streams[i];
+
+        if (avcodec_parameters_copy(stream->codecpar, entry->streams[i].codecpar) < 0) {
+            cache.misses_count++;
+            return false;
+        }
+
+        stream->start_time = entry->streams[i].start_time;
+        stream->duration = entry->streams[i].duration;
+    }
+
+    format_ctx->start_time = entry->start_time;
+    format_ctx->duration = entry->duration;
+    format_ctx->bit_rate = entry->bit_rate;
+
+    cache.entries.splice(cache.entries.begin(), cache.entries, item->second);
+    cache.hits_count++;
+    return true;
+}
+
+void probe_cache_store(const char *path, AVFormatContext *format_ctx) {
+    auto entry = new probe_cache_entry();
+    entry->path = path;
+
+    if (!read_source_key(path, &entry->source_size, &entry->source_mtime)) {
+        delete entry;
+        return;
+    }
+
+    entry->start_time = format_ctx->start_time;
+    entry->duration = format_ctx->duration;
+    entry->bit_rate = format_ctx->bit_rate;
+
+    for (unsigned int i = 0; i < format_ctx->nb_streams; ++i) {
+        AVStream *stream = format_ctx->streams[i];
+        AVCodecParameters *codecpar = avcodec_parameters_alloc();
+
+        if (codecpar == nullptr || avcodec_parameters_copy(codecpar, stream->codecpar) < 0) {
+            avcodec_parameters_free(&codecpar);
+            free_probe_cache_entry(entry);
+            return;
+        }
+
+        entry->streams.push_back(probe_cache_stream_entry{codecpar, stream->start_time, stream->duration});
+    }
+
+    probe_cache_ctx &cache = get_probe_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    if (cache.capacity == 0) {
+        free_probe_cache_entry(entry);
+        return;
+    }
+
+    erase_probe_cache_entry(cache, entry->path);
+    cache.entries.push_front(entry);
+    cache.entries_map[entry->path] = cache.entries.begin();
+    trim_probe_cache(cache);
+}
+
+extern "C"
+void probe_cache_set_capacity(size_t capacity) {
+    probe_cache_ctx &cache = get_probe_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.capacity = capacity;
+    trim_probe_cache(cache);
+}
+
+extern "C"
+void probe_cache_get_stats(int64_t *hits_count, int64_t *misses_count) {
+    probe_cache_ctx &cache = get_probe_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    *hits_count = cache.hits_count;
+    *misses_count = cache.misses_count;
+}
+
+extern "C"
+void probe_cache_clear() {
+    probe_cache_ctx &cache = get_probe_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    while (!cache.entries.empty()) {
+        erase_probe_cache_entry(cache, cache.entries.back()->path);
+    }
+
+    cache.hits_count = 0;
+    cache.misses_count = 0;
+}
@@ -0,0 +1,29 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_PROBE_CACHE_PROBE_CACHE_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_PROBE_CACHE_PROBE_CACHE_HPP_
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+#include <cstddef>
+#include <cstdint>
+
+// Восстанавливает параметры потоков открытого файла из кэша. Возвращает false, если записи нет или она устарела.
+bool probe_cache_restore(const char *path, AVFormatContext *format_ctx);
+
+// Сохраняет в кэш параметры потоков, найденные avformat_find_stream_info
+void probe_cache_store(const char *path, AVFormatContext *format_ctx);
+
+// Задает максимальное количество записей в кэше. Нулевое значение, как и по умолчанию, отключает кэш.
+extern "C"
+void probe_cache_set_capacity(size_t capacity);
+
+// Выдает количество попаданий и промахов кэша
+extern "C"
+void probe_cache_get_stats(int64_t *hits_count, int64_t *misses_count);
+
+// Очищает кэш и сбрасывает счетчики
+extern "C"
+void probe_cache_clear();
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_PROBE_CACHE_PROBE_CACHE_HPP_
@@ -0,0 +1,47 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_PROBE_CACHE_PROBE_CACHE_CONTEXT_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_PROBE_CACHE_PROBE_CACHE_CONTEXT_HPP_
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+#include <unordered_map>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <list>
+
+// Количество записей в кэше по умолчанию. Кэш выключен, пока его не включат явно: файл, перезаписанный
+// с тем же размером в пределах точности времени изменения, иначе откроется с устаревшими параметрами.
+#define PROBE_CACHE_DEFAULT_CAPACITY 0
+
+// Параметры потока, найденные avformat_find_stream_info
+struct probe_cache_stream_entry {
+  AVCodecParameters *codecpar = nullptr;
+  int64_t start_time = 0;
+  int64_t duration = 0;
+};
+
+// Результат анализа файла. Считается актуальным, пока не изменились размер и время изменения файла.
+struct probe_cache_entry {
+  std::string path;
+  uint64_t source_size = 0;
+  int64_t source_mtime = 0;
+  int64_t start_time = 0;
+  int64_t duration = 0;
+  int64_t bit_rate = 0;
+  std::vector<probe_cache_stream_entry> streams;
+};
+
+struct probe_cache_ctx {
+  std::mutex mutex;
+  std::size_t capacity = PROBE_CACHE_DEFAULT_CAPACITY;
+  int64_t hits_count = 0;
+  int64_t misses_count = 0;
+  // В начале списка находятся последние использованные записи
+  std::list<probe_cache_entry *> entries;
+  std::unordered_map<std::string, std::list<probe_cache_entry *>::iterator> entries_map;
+};
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_PROBE_CACHE_PROBE_CACHE_CONTEXT_HPP_
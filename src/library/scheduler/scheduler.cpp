@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "scheduler.hpp"
+#include "scheduler_context.hpp"
+#include "scheduler_errors.hpp"
+
+// Выдает общий для процесса планировщик
+scheduler_ctx &get_scheduler() {
+    static scheduler_ctx scheduler;
+    return scheduler;
+}
+
+// Выдает слот текущего потока
+scheduler_thread_state &get_thread_state() {
+    thread_local scheduler_thread_state state;
+    return state;
+}
+
+// Выдает максимальное количество одновременно работающих задач
+int get_max_workers(scheduler_ctx &scheduler) {
+    return scheduler.max_workers > 0
+           ? scheduler.max_workers
+           : std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+}
+
+// Проверяет, что слот ждут задачи с приоритетом выше указанного
+bool has_higher_priority_waiters(scheduler_ctx &scheduler, scheduler_priority priority) {
+    for (int i = 0; i < priority; ++i) {
+        if (scheduler.queues[i].waiting_count > 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Выдает время в микросекундах для счетчиков ожидания
+int64_t get_scheduler_time_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Ставит задачу в очередь ее приоритета и ожидает слота. Слот достается задаче, если свободен,
+// если перед ней в ее очереди никого нет и если его не ждут задачи более высокого приоритета.
+// Возвращает false, если ожидание прервано.
+bool wait_for_slot(scheduler_ctx &scheduler,
+                   scheduler_priority priority,
+                   int (*interrupt_callback)(void *) = nullptr,
+                   void *opaque = nullptr) {
+    scheduler_queue &queue = scheduler.queues[priority];
+    int64_t started_at = get_scheduler_time_us();
+    std::unique_lock<std::mutex> lock(scheduler.mutex);
+    uint64_t ticket = queue.issued_count++;
+    queue.tickets.push_back(ticket);
+    queue.waiting_count++;
+
+    bool interrupted = false;
+    scheduler.slots_changed.wait(lock, [&] {
+      interrupted = interrupt_callback != nullptr && interrupt_callback(opaque) != 0;
+      return interrupted
+          || (scheduler.running_count < get_max_workers(scheduler)
+              && queue.tickets.front() == ticket
+              && !has_higher_priority_waiters(scheduler, priority));
+    });
+
+    queue.tickets.erase(std::find(queue.tickets.begin(), queue.tickets.end(), ticket));
+    queue.waiting_count--;
+
+    if (interrupted) {
+        // Задачи, ожидавшие за прерванной, могут получить слот
+        scheduler.slots_changed.notify_all();
+        return false;
+    }
+
+    scheduler.running_count++;
+
+    int64_t wait_time_us = get_scheduler_time_us() - started_at;
+    queue.stats.acquisitions_count++;
+    queue.stats.total_wait_time_us += wait_time_us;
+    queue.stats.max_wait_time_us = std::max(queue.stats.max_wait_time_us, wait_time_us);
+
+    // Следующая задача в очереди тоже может получить слот, если он есть
+    scheduler.slots_changed.notify_all();
+    return true;
+}
+
+// Возвращает слот планировщику
+void return_slot(scheduler_ctx &scheduler) {
+    {
+        std::lock_guard<std::mutex> lock(scheduler.mutex);
+        scheduler.running_count--;
+    }
+
+    scheduler.slots_changed.notify_all();
+}
+
+void scheduler_set_max_workers(int max_workers) {
+    scheduler_ctx &scheduler = get_scheduler();
+
+    {
+        std::lock_guard<std::mutex> lock(scheduler.mutex);
+        scheduler.max_workers = std::max(max_workers, 0);
+    }
+
+    scheduler.slots_changed.notify_all();
+}
+
+void scheduler_set_thread_priority(scheduler_priority priority) {
+    get_thread_state().priority = std::clamp(priority, SCHEDULER_PRIORITY_INTERACTIVE, SCHEDULER_PRIORITY_BATCH);
+}
+
+scheduler_priority scheduler_get_thread_priority() {
+    return get_thread_state().priority;
+}
+
+void scheduler_acquire() {
+    scheduler_thread_state &state = get_thread_state();
+
+    if (state.depth++ == 0) {
+        wait_for_slot(get_scheduler(), state.priority);
+    }
+}
+
+int scheduler_acquire_interruptible(int (*interrupt_callback)(void *), void *opaque) {
+    scheduler_thread_state &state = get_thread_state();
+
+    if (state.depth == 0 && !wait_for_slot(get_scheduler(), state.priority, interrupt_callback, opaque)) {
+        return SCHEDULER_INTERRUPTED_ERROR;
+    }
+
+    state.depth++;
+    return 0;
+}
+
+void scheduler_wake_waiters() {
+    scheduler_ctx &scheduler = get_scheduler();
+
+    // Блокировка гарантирует, что ожидающий не пропустит пробуждение между проверкой и засыпанием
+    {
+        std::lock_guard<std::mutex> lock(scheduler.mutex);
+    }
+
+    scheduler.slots_changed.notify_all();
+}
+
+void scheduler_release() {
+    scheduler_thread_state &state = get_thread_state();
+
+    if (state.depth > 0 && --state.depth == 0) {
+        if (state.suspended) {
+            state.suspended = false;
+        } else {
+            return_slot(get_scheduler());
+        }
+    }
+}
+
+void scheduler_suspend() {
+    scheduler_thread_state &state = get_thread_state();
+
+    if (state.depth > 0 && !state.suspended) {
+        state.suspended = true;
+        return_slot(get_scheduler());
+    }
+}
+
+void scheduler_resume() {
+    scheduler_thread_state &state = get_thread_state();
+
+    if (state.suspended) {
+        wait_for_slot(get_scheduler(), state.priority);
+        state.suspended = false;
+    }
+}
+
+int scheduler_yield() {
+    return scheduler_yield_interruptible(nullptr, nullptr);
+}
+
+int scheduler_yield_interruptible(int (*interrupt_callback)(void *), void *opaque) {
+    scheduler_thread_state &state = get_thread_state();
+    scheduler_ctx &scheduler = get_scheduler();
+
+    // Счетчики ожидающих читаются без блокировки, поэтому проверка на каждом фрейме почти бесплатна
+    if (state.depth == 0 || state.suspended || !has_higher_priority_waiters(scheduler, state.priority)) {
+        return 0;
+    }
+
+    return_slot(scheduler);
+
+    // Прерванная задача остается без слота до своего scheduler_release
+    if (!wait_for_slot(scheduler, state.priority, interrupt_callback, opaque)) {
+        state.suspended = true;
+        return SCHEDULER_INTERRUPTED_ERROR;
+    }
+
+    std::lock_guard<std::mutex> lock(scheduler.mutex);
+    scheduler.queues[state.priority].stats.yields_count++;
+    return 1;
+}
+
+void scheduler_get_stats(scheduler_priority priority, scheduler_priority_stats *stats) {
+    scheduler_ctx &scheduler = get_scheduler();
+    std::lock_guard<std::mutex> lock(scheduler.mutex);
+    *stats = scheduler.queues[priority].stats;
+    stats->waiting_count = scheduler.queues[priority].waiting_count;
+}
+
+void scheduler_reset_stats() {
+    scheduler_ctx &scheduler = get_scheduler();
+    std::lock_guard<std::mutex> lock(scheduler.mutex);
+
+    for (auto &queue : scheduler.queues) {
+        queue.stats = scheduler_priority_stats{};
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_SCHEDULER_SCHEDULER_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_SCHEDULER_SCHEDULER_HPP_
+
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+// Классы приоритетов задач. Меньшее значение обслуживается раньше.
+enum scheduler_priority {
+  // Интерактивные запросы, например предпросмотр
+  SCHEDULER_PRIORITY_INTERACTIVE = 0,
+  SCHEDULER_PRIORITY_NORMAL = 1,
+  // Длинные фоновые задачи, уступающие слот более приоритетным
+  SCHEDULER_PRIORITY_BATCH = 2,
+  SCHEDULER_PRIORITIES_COUNT = 3
+};
+
+// Счетчики задач одного приоритета
+struct scheduler_priority_stats {
+  int64_t acquisitions_count;
+  // Суммарное и максимальное время ожидания слота в очереди в микросекундах
+  int64_t total_wait_time_us;
+  int64_t max_wait_time_us;
+  // Сколько раз задачи уступали слот более приоритетным
+  int64_t yields_count;
+  // Сколько задач ожидает слота сейчас
+  int64_t waiting_count;
+};
+
+// Задает максимальное количество одновременно работающих задач. При 0 оно выбирается по числу ядер.
+extern "C"
+void scheduler_set_max_workers(int max_workers);
+
+// Задает приоритет, с которым задачи текущего потока ожидают слота
+extern "C"
+void scheduler_set_thread_priority(scheduler_priority priority);
+
+// Выдает приоритет задач текущего потока
+extern "C"
+scheduler_priority scheduler_get_thread_priority();
+
+// Ожидает свободного слота для задачи текущего потока. Повторный вызов в том же потоке
+// использует уже занятый слот.
+extern "C"
+void scheduler_acquire();
+
+// Ожидает слота как scheduler_acquire, но прекращает ожидание, как только interrupt_callback вернет
+// ненулевое значение. Возвращает SCHEDULER_INTERRUPTED_ERROR, если слот не был получен.
+extern "C"
+int scheduler_acquire_interruptible(int (*interrupt_callback)(void *), void *opaque);
+
+// Будит ожидающие слота задачи, чтобы они заново проверили условия прерывания
+extern "C"
+void scheduler_wake_waiters();
+
+// Освобождает слот текущего потока
+extern "C"
+void scheduler_release();
+
+// Отдает слот текущего потока на время блокирующего ожидания ввода-вывода
+extern "C"
+void scheduler_suspend();
+
+// Снова ожидает слота, отданного scheduler_suspend
+extern "C"
+void scheduler_resume();
+
+// Уступает слот, если его ждут задачи более высокого приоритета, и ожидает его снова.
+// Вызывается на границах фреймов длинных задач. Возвращает 1, если слот был уступлен.
+extern "C"
+int scheduler_yield();
+
+// Уступает слот как scheduler_yield, но прекращает ожидание его возврата, как только interrupt_callback
+// вернет ненулевое значение. Тогда возвращает SCHEDULER_INTERRUPTED_ERROR, а слот остается свободным.
+extern "C"
+int scheduler_yield_interruptible(int (*interrupt_callback)(void *), void *opaque);
+
+// Выдает счетчики задач указанного приоритета
+extern "C"
+void scheduler_get_stats(scheduler_priority priority, scheduler_priority_stats *stats);
+
+// Обнуляет счетчики всех приоритетов
+extern "C"
+void scheduler_reset_stats();
+
+// Занимает слот текущего потока на время своей жизни
+struct scheduler_slot_guard {
+  scheduler_slot_guard() {
+      scheduler_acquire();
+  }
+
+  // Занимает слот для рабочего потока задачи с приоритетом этой задачи
+  explicit scheduler_slot_guard(scheduler_priority priority) {
+      scheduler_set_thread_priority(priority);
+      scheduler_acquire();
+  }
+
+  ~scheduler_slot_guard() {
+      scheduler_release();
+  }
+
+  scheduler_slot_guard(const scheduler_slot_guard &) = delete;
+  scheduler_slot_guard &operator=(const scheduler_slot_guard &) = delete;
+};
+
+// Ожидает условия, отдавая слот текущего потока, пока условие не выполнено.
+// Рабочие потоки одной задачи ждут друг друга, не удерживая слоты, поэтому не блокируются при их нехватке.
+template<typename Predicate>
+void scheduler_wait(std::unique_lock<std::mutex> &lock, std::condition_variable &condition, Predicate predicate) {
+    while (!predicate()) {
+        lock.unlock();
+        scheduler_suspend();
+        lock.lock();
+        condition.wait(lock, predicate);
+        lock.unlock();
+        scheduler_resume();
+        lock.lock();
+    }
+}
+
+// Ожидает завершения рабочего потока, отдав на это время слот текущего потока
+inline void scheduler_join(std::thread &thread) {
+    scheduler_suspend();
+    thread.join();
+    scheduler_resume();
+}
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_SCHEDULER_SCHEDULER_HPP_
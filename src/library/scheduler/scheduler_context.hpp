@@ -0,0 +1,39 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_SCHEDULER_SCHEDULER_CONTEXT_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_SCHEDULER_SCHEDULER_CONTEXT_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+#include "scheduler.hpp"
+
+// Очередь ожидающих слота задач одного приоритета. Слоты выдаются по порядку номеров.
+struct scheduler_queue {
+  uint64_t issued_count = 0;
+  // Номера ожидающих задач. Прерванная задача удаляет свой номер, не задерживая следующие.
+  std::deque<uint64_t> tickets;
+  // Количество ожидающих задач, читается без блокировки при уступке слота
+  std::atomic<int64_t> waiting_count{0};
+  scheduler_priority_stats stats{};
+};
+
+// Общий для процесса планировщик слотов процессора
+struct scheduler_ctx {
+  std::mutex mutex;
+  std::condition_variable slots_changed;
+  int max_workers = 0;
+  int running_count = 0;
+  scheduler_queue queues[SCHEDULER_PRIORITIES_COUNT];
+};
+
+// Слот текущего потока. Вложенные входы в библиотеку используют уже занятый слот.
+struct scheduler_thread_state {
+  scheduler_priority priority = SCHEDULER_PRIORITY_NORMAL;
+  int depth = 0;
+  // Слот отдан на время блокирующего ввода-вывода
+  bool suspended = false;
+};
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_SCHEDULER_SCHEDULER_CONTEXT_HPP_
@@ -0,0 +1,6 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_SCHEDULER_SCHEDULER_ERRORS_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_SCHEDULER_SCHEDULER_ERRORS_HPP_
+
+#define SCHEDULER_INTERRUPTED_ERROR (-1)
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_SCHEDULER_SCHEDULER_ERRORS_HPP_
@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+}
+
+#include "seek_index.hpp"
+#include "seek_index_context.hpp"
+#include "seek_index_errors.hpp"
+
+// Считает хэш FNV-1a от абсолютного пути к источнику
+uint64_t hash_source_path(const char *path) {
+    std::error_code error;
+    auto absolute_path = std::filesystem::absolute(path, error).string();
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (unsigned char symbol : absolute_path) {
+        hash ^= symbol;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+// Заполняет в заголовке поля, идентифицирующие источник
+bool fill_source_key(const char *path, seek_index_header *header) {
+    std::error_code error;
+    auto size = std::filesystem::file_size(path, error);
+
+    if (error) {
+        return false;
+    }
+
+    auto mtime = std::filesystem::last_write_time(path, error);
+
+    if (error) {
+        return false;
+    }
+
+    header->source_size = size;
+    header->source_mtime = mtime.time_since_epoch().count();
+    header->source_path_hash = hash_source_path(path);
+    return true;
+}
+
+// Записывает индекс во временный файл и атомарно подменяет им старый
+bool write_index_file(const char *index_path,
+                      const seek_index_header &header,
+                      const std::vector<seek_index_entry> &entries) {
+    std::string temp_path = std::string(index_path) + ".tmp";
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(entries.data()),
+               static_cast<std::streamsize>(entries.size() * sizeof(seek_index_entry)));
+    file.close();
+
+    if (!file) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    return std::rename(temp_path.c_str(), index_path) == 0;
+}
+
+// Собирает времена и смещения пакетов потока, не декодируя их
+int collect_entries(AVFormatContext *format_ctx, int stream_index, std::vector<seek_index_entry> &entries) {
+    AVPacket *packet = av_packet_alloc();
+    int read_result;
+
+    while ((read_result = av_read_frame(format_ctx, packet)) >= 0) {
+        int64_t timestamp = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+
+        if (packet->stream_index == stream_index
+            && packet->pos >= 0
+            && timestamp != AV_NOPTS_VALUE
+            && (entries.empty() || timestamp > entries.back().timestamp)) {
+            entries.push_back(seek_index_entry{timestamp, packet->pos});
+        }
+
+        av_packet_unref(packet);
+    }
+
+    av_packet_free(&packet);
+    return read_result == AVERROR_EOF ? 0 : SEEK_INDEX_READING_ERROR;
+}
+
+int seek_index_build(const char *path, const char *index_path) {
+    AVFormatContext *format_ctx = avformat_alloc_context();
+
+    if (avformat_open_input(&format_ctx, path, nullptr, nullptr) < 0) {
+        avformat_free_context(format_ctx);
+        return SEEK_INDEX_INPUT_OPENING_ERROR;
+    }
+
+    if (avformat_find_stream_info(format_ctx, nullptr) < 0) {
+        avformat_close_input(&format_ctx);
+        return SEEK_INDEX_INPUT_OPENING_ERROR;
+    }
+
+    int stream_index = av_find_best_stream(format_ctx, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+
+    if (stream_index < 0) {
+        avformat_close_input(&format_ctx);
+        return SEEK_INDEX_STREAM_NOT_FOUND_ERROR;
+    }
+
+    for (unsigned int i = 0; i < format_ctx->nb_streams; ++i) {
+        if ((int) i != stream_index) {
+            format_ctx->streams[i]->discard = AVDISCARD_ALL;
+        }
+    }
+
+    std::vector<seek_index_entry> entries;
+    AVRational time_base = format_ctx->streams[stream_index]->time_base;
+    int collect_result = collect_entries(format_ctx, stream_index, entries);
+    avformat_close_input(&format_ctx);
+
+    if (collect_result < 0) {
+        return collect_result;
+    }
+
+    seek_index_header header{};
+    memcpy(header.magic, SEEK_INDEX_MAGIC, sizeof(header.magic));
+    header.stream_index = stream_index;
+    header.time_base_num = time_base.num;
+    header.time_base_den = time_base.den;
+    header.entries_count = entries.size();
+
+    if (!fill_source_key(path, &header)) {
+        return SEEK_INDEX_INPUT_OPENING_ERROR;
+    }
+
+    return write_index_file(index_path, header, entries) ? 0 : SEEK_INDEX_WRITING_ERROR;
+}
+
+// Проверяет, что индекс построен для текущей версии источника
+bool is_index_actual(const char *path, const seek_index_header *header) {
+    seek_index_header source_key{};
+
+    return fill_source_key(path, &source_key)
+        && source_key.source_size == header->source_size
+        && source_key.source_mtime == header->source_mtime
+        && source_key.source_path_hash == header->source_path_hash;
+}
+
+int seek_index_open(void **ctx_ref, const char *path, const char *index_path) {
+    int fd = open(index_path, O_RDONLY);
+
+    if (fd < 0) {
+        return SEEK_INDEX_READING_ERROR;
+    }
+
+    struct stat index_stat{};
+
+    if (fstat(fd, &index_stat) < 0 || static_cast<size_t>(index_stat.st_size) < sizeof(seek_index_header)) {
+        close(fd);
+        return SEEK_INDEX_READING_ERROR;
+    }
+
+    auto mapping_size = static_cast<size_t>(index_stat.st_size);
+    void *mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        return SEEK_INDEX_READING_ERROR;
+    }
+
+    auto header = static_cast<const seek_index_header *>(mapping);
+
+    if (memcmp(header->magic, SEEK_INDEX_MAGIC, sizeof(header->magic)) != 0
+        || header->time_base_num <= 0
+        || header->time_base_den <= 0
+        || sizeof(seek_index_header) + header->entries_count * sizeof(seek_index_entry) != mapping_size) {
+        munmap(mapping, mapping_size);
+        return SEEK_INDEX_READING_ERROR;
+    }
+
+    if (!is_index_actual(path, header)) {
+        munmap(mapping, mapping_size);
+        return SEEK_INDEX_STALE_ERROR;
+    }
+
+    // К записям обращаемся двоичным поиском, упреждающее чтение тут бесполезно
+    madvise(mapping, mapping_size, MADV_RANDOM);
+
+    *ctx_ref = new seek_index_ctx{
+        mapping,
+        mapping_size,
+        header,
+        reinterpret_cast<const seek_index_entry *>(header + 1)
+    };
+
+    return 0;
+}
+
+// Ищет номер последней записи, начинающейся не позже указанного момента во времени потока
+int64_t find_entry_index(seek_index_ctx *ctx, int64_t timestamp) {
+    auto entries_end = ctx->entries + ctx->header->entries_count;
+    auto next_entry = std::upper_bound(ctx->entries,
+                                       entries_end,
+                                       timestamp,
+                                       [](int64_t value, const seek_index_entry &entry) {
+                                         return value < entry.timestamp;
+                                       });
+
+    return next_entry == ctx->entries ? -1 : next_entry - ctx->entries - 1;
+}
+
+int seek_index_find(void *ctx_ref, int64_t timestamp_in_us, int64_t *pts_in_us, int64_t *pos) {
+    auto casted_ctx = static_cast<seek_index_ctx *>(ctx_ref);
+    AVRational time_base{casted_ctx->header->time_base_num, casted_ctx->header->time_base_den};
+    int64_t entry_index = find_entry_index(casted_ctx, av_rescale_q(timestamp_in_us, AV_TIME_BASE_Q, time_base));
+
+    if (entry_index < 0) {
+        return SEEK_INDEX_ENTRY_NOT_FOUND_ERROR;
+    }
+
+    *pts_in_us = av_rescale_q(casted_ctx->entries[entry_index].timestamp, time_base, AV_TIME_BASE_Q);
+    *pos = casted_ctx->entries[entry_index].pos;
+    return 0;
+}
+
+int seek_index_seek(void *ctx_ref, AVFormatContext *format_ctx, int64_t timestamp_in_us) {
+    auto casted_ctx = static_cast<seek_index_ctx *>(ctx_ref);
+    int stream_index = casted_ctx->header->stream_index;
+
+    if (stream_index < 0 || static_cast<unsigned int>(stream_index) >= format_ctx->nb_streams) {
+        return SEEK_INDEX_STREAM_NOT_FOUND_ERROR;
+    }
+
+    AVStream *stream = format_ctx->streams[stream_index];
+    int64_t timestamp = av_rescale_q(timestamp_in_us, AV_TIME_BASE_Q, stream->time_base);
+    int64_t entry_index = find_entry_index(casted_ctx, timestamp);
+
+    if (entry_index < 0) {
+        return SEEK_INDEX_ENTRY_NOT_FOUND_ERROR;
+    }
+
+    // Достаточно передать демуксеру соседние с моментом пакеты: по ним он перейдет
+    // сразу к нужной позиции без бисекции и без разбора TOC.
+    for (int64_t i = entry_index; i < entry_index + 2 && i < (int64_t) casted_ctx->header->entries_count; ++i) {
+        const seek_index_entry &entry = casted_ctx->entries[i];
+
+        if (av_add_index_entry(stream, entry.pos, entry.timestamp, 0, 0, AVINDEX_KEYFRAME) < 0) {
+            return SEEK_INDEX_UNEXPECTED_ERROR;
+        }
+    }
+
+    if (av_seek_frame(format_ctx, stream_index, timestamp, AVSEEK_FLAG_BACKWARD) < 0) {
+        return SEEK_INDEX_UNEXPECTED_ERROR;
+    }
+
+    return 0;
+}
+
+void seek_index_free(void **ctx_ref) {
+    auto casted_ctx = static_cast<seek_index_ctx *>(*ctx_ref);
+    munmap(casted_ctx->mapping, casted_ctx->mapping_size);
+    delete casted_ctx;
+    *ctx_ref = nullptr;
+}
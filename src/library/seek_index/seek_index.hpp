@@ -0,0 +1,25 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_SEEK_INDEX_SEEK_INDEX_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_SEEK_INDEX_SEEK_INDEX_HPP_
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+#include <cstdint>
+
+// Строит индекс перемотки для первого аудио-потока файла и сохраняет его рядом в index_path
+int seek_index_build(const char *path, const char *index_path);
+
+// Открывает индекс перемотки, отображая его в память. Устаревший индекс не открывается.
+int seek_index_open(void **ctx_ref, const char *path, const char *index_path);
+
+// Ищет последний пакет, начинающийся не позже указанного момента в микросекундах
+int seek_index_find(void *ctx_ref, int64_t timestamp_in_us, int64_t *pts_in_us, int64_t *pos);
+
+// Перематывает контекст формата к указанному моменту в микросекундах, используя индекс
+int seek_index_seek(void *ctx_ref, AVFormatContext *format_ctx, int64_t timestamp_in_us);
+
+// Освобождает ресурсы индекса
+void seek_index_free(void **ctx_ref);
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_SEEK_INDEX_SEEK_INDEX_HPP_
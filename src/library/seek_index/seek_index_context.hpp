@@ -0,0 +1,35 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_SEEK_INDEX_SEEK_INDEX_CONTEXT_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_SEEK_INDEX_SEEK_INDEX_CONTEXT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#define SEEK_INDEX_MAGIC "FMTSIDX1"
+
+// Заголовок файла индекса. Источник определяется хэшем пути, размером и временем изменения.
+struct seek_index_header {
+  char magic[8];
+  uint64_t source_size = 0;
+  int64_t source_mtime = 0;
+  uint64_t source_path_hash = 0;
+  int32_t stream_index = 0;
+  int32_t time_base_num = 0;
+  int32_t time_base_den = 0;
+  uint32_t reserved = 0;
+  uint64_t entries_count = 0;
+};
+
+// Запись индекса: время пакета в единицах потока и его смещение в файле
+struct seek_index_entry {
+  int64_t timestamp;
+  int64_t pos;
+};
+
+struct seek_index_ctx {
+  void *mapping = nullptr;
+  std::size_t mapping_size = 0;
+  const seek_index_header *header = nullptr;
+  const seek_index_entry *entries = nullptr;
+};
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_SEEK_INDEX_SEEK_INDEX_CONTEXT_HPP_
@@ -0,0 +1,12 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_SEEK_INDEX_SEEK_INDEX_ERRORS_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_SEEK_INDEX_SEEK_INDEX_ERRORS_HPP_
+
+#define SEEK_INDEX_INPUT_OPENING_ERROR (-1)
+#define SEEK_INDEX_STREAM_NOT_FOUND_ERROR (-2)
+#define SEEK_INDEX_WRITING_ERROR (-3)
+#define SEEK_INDEX_READING_ERROR (-4)
+#define SEEK_INDEX_STALE_ERROR (-5)
+#define SEEK_INDEX_ENTRY_NOT_FOUND_ERROR (-6)
+#define SEEK_INDEX_UNEXPECTED_ERROR (-7)
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_SEEK_INDEX_SEEK_INDEX_ERRORS_HPP_
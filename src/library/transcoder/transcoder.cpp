@@ -1,85 +1,826 @@
 #include "transcoder.hpp"
 #include "transcoder_errors.hpp"
+#include "transcoder_context.hpp"
 
 #include "../decoder/decoder.hpp"
 #include "../decoder/decoder_errors.hpp"
 #include "../encoder/encoder.hpp"
 #include "../encoder/encoder_errors.hpp"
 #include "../resampler/resampler.hpp"
-#include "../buffer/buffer.hpp"
+#include "../io/io.hpp"
+#include "transcoder_frame_queue.hpp"
+#include "../job_pool/job_pool.hpp"
+#include "../scheduler/scheduler.hpp"
 
-// Считает необходимое количество байт для кодирования полного фрейма
-size_t get_need_bytes_count_at_encoder(void *enc_ctx) {
-    return encoder_get_samples_count_per_frame(enc_ctx, 0) * encoder_get_bytes_per_sample_count(enc_ctx, 0);
+extern "C" {
+#include <libavcodec/bsf.h>
 }
 
-// Кодирует аудио-фрейм
-bool encode_audio(void *buf_ctx, void *enc_ctx, size_t data_len) {
-    if (encoder_encode(enc_ctx, 0, buffer_get_pointer(buf_ctx), data_len) >= 0) {
-        buffer_delete_from_start(buf_ctx, data_len);
-        return true;
-    }
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <climits>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
 
-    return false;
-}
+// Длина сегмента при параллельном кодировании в секундах. Вместе с очередью сегментов ограничивает
+// объем декодированного аудио в памяти независимо от длины записи.
+#define TRANSCODER_SEGMENT_LENGTH 10
+
+// Емкость очередей фреймов между стадиями конвейера по умолчанию
+#define TRANSCODER_PIPELINE_QUEUE_CAPACITY 8
+
+// Количество фреймов энкодера, на которое сегменты заходят друг на друга для прогрева энкодера
+#define TRANSCODER_SEGMENT_OVERLAP_FRAMES 4
 
-// Ресемплит и кодирует аудио-фрейм
+// Ресемплит аудио-фрейм прямо в плоскости фрейма энкодера и кодирует заполненные фреймы
 bool resample_and_encode_audio(const uint8_t **data,
                                int data_len,
                                void *sampler_ctx,
-                               void *enc_ctx,
-                               void *buf_ctx) {
-    int need_bytes_at_buffer = resampler_get_need_bytes_count(sampler_ctx, data_len);
-    uint8_t **last_buffer_pointers = buffer_allocate_new_columns(buf_ctx, need_bytes_at_buffer);
+                               void *enc_ctx) {
+    int bytes_per_sample = encoder_get_bytes_per_sample_count(enc_ctx, 0);
+    int need_samples = resampler_get_need_bytes_count(sampler_ctx, data_len) / bytes_per_sample;
+    uint8_t **planes = encoder_get_writable_planes(enc_ctx, 0, need_samples);
+
+    if (planes == nullptr) {
+        return false;
+    }
 
-    if (resampler_resample(sampler_ctx, data, data_len, last_buffer_pointers) < 0) {
-        delete[] last_buffer_pointers;
+    int resampled_bytes = resampler_resample(sampler_ctx, data, data_len, planes);
+
+    if (resampled_bytes < 0) {
         return false;
     }
 
-    delete[] last_buffer_pointers;
-    size_t need_bytes_at_encoder = get_need_bytes_count_at_encoder(enc_ctx);
+    return encoder_commit_written_samples(enc_ctx, 0, resampled_bytes / bytes_per_sample) >= 0;
+}
+
+// Проверяет, что транскодирование отменено
+bool is_transcoding_cancelled(transcoder_control *control) {
+    return control != nullptr && control->cancelled;
+}
+
+// Прерывает блокирующий ввод-вывод отмененного транскодирования
+int interrupt_transcoding(void *opaque) {
+    return is_transcoding_cancelled(static_cast<transcoder_control *>(opaque)) ? 1 : 0;
+}
+
+// Конвейер транскодирования: декодирование выполняется в отдельном потоке, а ресемплинг и кодирование -
+// в вызывающем. Ресемплер пишет прямо в плоскости фрейма энкодера, поэтому между ними нет очереди.
+struct transcoder_pipeline {
+  void *decoder_ctx = nullptr;
+  void *resampler_ctx = nullptr;
+  void *encoder_ctx = nullptr;
+  transcoder_control *control = nullptr;
+  transcoder_frame_queue decoded;
+  transcoder_pipeline_stats stats{};
+  // Размер семпла энкодера, определенный до запуска стадий
+  int bytes_per_sample = 0;
+  bool decoding_failed = false;
+};
+
+// Выдает монотонное время в микросекундах для счетчиков стадий
+int64_t get_monotonic_time_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Выдает размер плоскости аудио-фрейма в байтах
+int get_frame_plane_bytes_count(const AVFrame *frame) {
+    auto sample_format = static_cast<AVSampleFormat>(frame->format);
+
+    return frame->nb_samples * av_get_bytes_per_sample(sample_format)
+        * (av_sample_fmt_is_planar(sample_format) ? 1 : frame->channels);
+}
+
+// Декодирует вход, передавая фреймы стадии кодирования. Отмена проверяется перед каждым фреймом,
+// прогресс обновляется по каждому фрейму.
+void run_decoding_stage(transcoder_pipeline *pipeline, scheduler_priority priority) {
+    scheduler_slot_guard slot(priority);
+    transcoder_stage_stats *stats = &pipeline->stats.decoding;
+    transcoder_control *control = pipeline->control;
+    int64_t started_at = get_monotonic_time_us();
+
+    while (!is_transcoding_cancelled(control)) {
+        int res = decoder_decode_frames(pipeline->decoder_ctx, [pipeline, stats, control](AVFrame *frame) {
+          if (control != nullptr) {
+              control->decoded_us = std::max<int64_t>(frame->pts - control->start_us, 0);
+          }
+
+          int64_t waiting_started_at = get_monotonic_time_us();
+          bool pushed = transcoder_frame_queue_push(&pipeline->decoded, frame);
+          stats->idle_time_us += get_monotonic_time_us() - waiting_started_at;
+
+          if (!pushed) {
+              decoder_frame_free(&frame);
+              return false;
+          }
+
+          stats->frames_count++;
+          return true;
+        });
+
+        if (res == DECODER_END_OF_STREAM_ERROR) {
+            break;
+        } else if (res < 0) {
+            pipeline->decoding_failed = true;
+            break;
+        }
+
+        scheduler_yield_interruptible(interrupt_transcoding, control);
+    }
+
+    if (is_transcoding_cancelled(control)) {
+        pipeline->decoding_failed = true;
+    }
+
+    stats->busy_time_us = get_monotonic_time_us() - started_at - stats->idle_time_us;
+    transcoder_frame_queue_finish(&pipeline->decoded);
+}
+
+// Ресемплит декодированные фреймы прямо в плоскости фрейма энкодера и кодирует их.
+// Время ресемплинга учитывается отдельно от кодирования. Возвращает false при ошибке.
+bool run_encoding_stage(transcoder_pipeline *pipeline) {
+    transcoder_stage_stats *resampling_stats = &pipeline->stats.resampling;
+    transcoder_stage_stats *stats = &pipeline->stats.encoding;
+    int64_t started_at = get_monotonic_time_us();
+    bool result = true;
+    AVFrame *frame;
+
+    while (result && !is_transcoding_cancelled(pipeline->control)) {
+        int64_t waiting_started_at = get_monotonic_time_us();
+        bool popped = transcoder_frame_queue_pop(&pipeline->decoded, &frame);
+        stats->idle_time_us += get_monotonic_time_us() - waiting_started_at;
+
+        if (!popped) {
+            break;
+        }
+
+        int64_t resampling_started_at = get_monotonic_time_us();
+        int data_len = get_frame_plane_bytes_count(frame);
+        int need_samples = resampler_get_need_bytes_count(pipeline->resampler_ctx, data_len) / pipeline->bytes_per_sample;
+        uint8_t **planes = encoder_get_writable_planes(pipeline->encoder_ctx, 0, need_samples);
+        int resampled_bytes = planes != nullptr
+                              ? resampler_resample(pipeline->resampler_ctx,
+                                                   const_cast<const uint8_t **>(frame->extended_data),
+                                                   data_len,
+                                                   planes)
+                              : -1;
+        resampling_stats->busy_time_us += get_monotonic_time_us() - resampling_started_at;
+        decoder_frame_free(&frame);
+
+        if (resampled_bytes < 0) {
+            result = false;
+            break;
+        }
+
+        resampling_stats->frames_count++;
+        result = encoder_commit_written_samples(pipeline->encoder_ctx, 0, resampled_bytes / pipeline->bytes_per_sample) >= 0;
+        stats->frames_count++;
+
+        scheduler_yield_interruptible(interrupt_transcoding, pipeline->control);
+    }
+
+    stats->busy_time_us = get_monotonic_time_us() - started_at - stats->idle_time_us - resampling_stats->busy_time_us;
+
+    // Декодер, который еще не дошел до конца, больше не ждет места в очереди
+    transcoder_frame_queue_close(&pipeline->decoded);
+    return result && !is_transcoding_cancelled(pipeline->control);
+}
+
+// Транскодирует аудио конвейером: декодирование в отдельном потоке перекрывается с ресемплингом
+// и кодированием в вызывающем потоке. Слот планировщика уступается более приоритетным задачам на каждом фрейме.
+bool transcode_audio(void *dec_ctx,
+                     void *sampler_ctx,
+                     void *enc_ctx,
+                     transcoder_control *control = nullptr,
+                     int queue_capacity = TRANSCODER_PIPELINE_QUEUE_CAPACITY,
+                     transcoder_pipeline_stats *stats = nullptr) {
+    transcoder_pipeline pipeline;
+    pipeline.decoder_ctx = dec_ctx;
+    pipeline.resampler_ctx = sampler_ctx;
+    pipeline.encoder_ctx = enc_ctx;
+    pipeline.control = control;
+    pipeline.decoded.capacity = queue_capacity;
+    pipeline.bytes_per_sample = encoder_get_bytes_per_sample_count(enc_ctx, 0);
+
+    std::thread decoding_thread(run_decoding_stage, &pipeline, scheduler_get_thread_priority());
+    bool encoded = run_encoding_stage(&pipeline);
+
+    scheduler_join(decoding_thread);
+
+    if (stats != nullptr) {
+        *stats = pipeline.stats;
+    }
+
+    // Незаполненный до конца последний фрейм кодируется энкодером при завершении.
+    return encoded
+        && !pipeline.decoding_failed
+        && encoder_finish_encode(enc_ctx) >= 0;
+}
+
+// Выход транскодирования одного аудио-потока
+struct transcoder_audio_output {
+  void *encoder_ctx = nullptr;
+  void *resampler_ctx = nullptr;
+  encoder_stream_audio_codec_cfg *audio_cfg = nullptr;
+};
+
+// Переводит ошибку инициализации декодера в ошибку транскодера
+int get_decoder_init_error(int decoder_result) {
+    switch (decoder_result) {
+        case DECODER_UNSUPPORTED_MEDIA_TYPE_ERROR:
+        case DECODER_NOT_ALL_CODECS_FOUND_ERROR:return TRANSCODER_UNSUPPORTED_INPUT_FORMAT;
+        case DECODER_INPUT_OPENING_ERROR:return TRANSCODER_MAYBE_FILE_NOT_FOUND;
+        default:return TRANSCODER_UNEXPECTED_ERROR;
+    }
+}
+
+// Освобождает энкодер и ресемплер выхода
+void free_audio_output(transcoder_audio_output *output) {
+    if (output->encoder_ctx != nullptr) {
+        encoder_free(&output->encoder_ctx);
+    }
+
+    if (output->resampler_ctx != nullptr) {
+        resampler_free(&output->resampler_ctx);
+    }
+
+    delete output->audio_cfg;
+    output->audio_cfg = nullptr;
+}
+
+// Инициализирует энкодер и ресемплер для транскодирования потока с указанным индексом.
+// Если передан AVIOContext, ADTS записывается в него вместо файла.
+int init_audio_output(void *decoder_ctx,
+                      size_t stream_index,
+                      const char *out_path,
+                      transcoder_audio_output *output,
+                      AVIOContext *out_io = nullptr,
+                      const AVIOInterruptCB *interrupt_callback = nullptr) {
+    int in_sample_rate = decoder_get_sample_rate(decoder_ctx, stream_index);
+    int in_channels_count = decoder_get_channels_count(decoder_ctx, stream_index);
+    uint64_t in_channel_layout = decoder_get_channel_layout(decoder_ctx, stream_index);
+    AVSampleFormat in_sample_format = decoder_get_sample_format(decoder_ctx, stream_index);
+    output->audio_cfg = new encoder_stream_audio_codec_cfg{
+        in_sample_rate, in_channels_count, in_channel_layout, in_sample_format};
+
+    // Инициализируем энкодер
+    encoder_stream_cfg stream_cfg{AV_CODEC_ID_AAC, output->audio_cfg};
+    std::map<int, encoder_stream_cfg> encoders_configs{{0, stream_cfg}};
+    int encoder_result = out_io != nullptr
+                         ? encoder_init_with_io(&output->encoder_ctx, "adts", out_io, encoders_configs)
+                         : encoder_init(&output->encoder_ctx, out_path, encoders_configs, interrupt_callback);
+
+    if (encoder_result < 0) {
+        output->encoder_ctx = nullptr;
+        free_audio_output(output);
+
+        return encoder_result == ENCODER_OUTPUT_STREAM_ERROR && out_io == nullptr
+               ? TRANSCODER_MAYBE_FILE_ALREADY_EXIST
+               : TRANSCODER_UNEXPECTED_ERROR;
+    }
+
+    int resampler_result = resampler_init(&output->resampler_ctx,
+                                          static_cast<int64_t>(in_channel_layout),
+                                          static_cast<int64_t>(output->audio_cfg->channel_layout),
+                                          in_sample_format,
+                                          output->audio_cfg->sample_format,
+                                          in_sample_rate,
+                                          output->audio_cfg->sample_rate,
+                                          in_channels_count);
+
+    if (resampler_result < 0) {
+        output->resampler_ctx = nullptr;
+        free_audio_output(output);
+        return TRANSCODER_UNEXPECTED_ERROR;
+    }
 
-    while (buffer_get_colums_count(buf_ctx) >= need_bytes_at_encoder) {
-        if (!encode_audio(buf_ctx, enc_ctx, need_bytes_at_encoder)) {
+    return 0;
+}
+
+// Проверяет, что поток уже сжат в AAC с параметрами выхода и его пакеты можно копировать без перекодирования.
+// Фреймы AAC зависят от предыдущих, поэтому нарезка всегда перекодируется: первый скопированный
+// фрейм без предыдущего декодировался бы с искажениями.
+bool is_passthrough_possible(void *decoder_ctx, transcoder_audio_output *output) {
+    const AVCodecParameters *params = decoder_get_codec_parameters(decoder_ctx, 0);
+
+    return !decoder_is_range_trimmed(decoder_ctx)
+        && params->codec_id == AV_CODEC_ID_AAC
+        && params->profile == FF_PROFILE_AAC_LOW
+        && params->sample_rate == output->audio_cfg->sample_rate
+        && params->channels == output->audio_cfg->channels_count;
+}
+
+// Передает пакеты из фильтра в энкодер, сдвигая их время к началу нарезки
+bool write_filtered_packets(AVBSFContext *filter_ctx, AVPacket *packet, void *enc_ctx, int64_t *first_pts) {
+    int result;
+
+    while ((result = av_bsf_receive_packet(filter_ctx, packet)) >= 0) {
+        if (*first_pts == AV_NOPTS_VALUE) {
+            *first_pts = packet->pts;
+        }
+
+        packet->pts -= *first_pts;
+        packet->dts = packet->pts;
+
+        if (encoder_write_packet(enc_ctx, 0, packet) < 0) {
             return false;
         }
     }
 
-    return true;
+    return result == AVERROR(EAGAIN) || result == AVERROR_EOF;
+}
+
+// Копирует сжатые пакеты всего файла в выход без декодирования.
+// Заголовки ADTS входа снимаются фильтром, выход записывает свои.
+bool copy_audio_packets(void *dec_ctx, void *enc_ctx, transcoder_control *control = nullptr) {
+    const AVBitStreamFilter *filter = av_bsf_get_by_name("aac_adtstoasc");
+    const AVCodecParameters *params = decoder_get_codec_parameters(dec_ctx, 0);
+    AVBSFContext *filter_ctx;
+
+    if (filter == nullptr || av_bsf_alloc(filter, &filter_ctx) < 0) {
+        return false;
+    }
+
+    filter_ctx->time_base_in = AVRational{1, params->sample_rate};
+
+    if (avcodec_parameters_copy(filter_ctx->par_in, params) < 0 || av_bsf_init(filter_ctx) < 0) {
+        av_bsf_free(&filter_ctx);
+        return false;
+    }
+
+    AVPacket *packet = av_packet_alloc();
+    int64_t first_pts = AV_NOPTS_VALUE;
+    bool result = true;
+    int res = 0;
+
+    while (result && (res = decoder_read_packet(dec_ctx, packet)) > 0) {
+        scheduler_yield_interruptible(interrupt_transcoding, control);
+
+        if (control != nullptr) {
+            int64_t sample_rate = params->sample_rate;
+            control->decoded_us = std::max<int64_t>(av_rescale(packet->pts, AV_TIME_BASE, sample_rate)
+                                                        - control->start_us, 0);
+        }
+
+        result = !is_transcoding_cancelled(control)
+            && av_bsf_send_packet(filter_ctx, packet) >= 0
+            && write_filtered_packets(filter_ctx, packet, enc_ctx, &first_pts);
+    }
+
+    result = result
+        && res == DECODER_END_OF_STREAM_ERROR
+        && av_bsf_send_packet(filter_ctx, nullptr) >= 0
+        && write_filtered_packets(filter_ctx, packet, enc_ctx, &first_pts);
+
+    av_packet_free(&packet);
+    av_bsf_free(&filter_ctx);
+
+    return result && encoder_finish_encode(enc_ctx) >= 0;
 }
 
-// Запускает декодирование аудио и далее транскодирует его
-bool transcode_audio(void *dec_ctx, void *sampler_ctx, void *enc_ctx, void *buf_ctx) {
+// Транскодирует аудио, для которого был инициализирован декодер
+int transcode_decoded_audio(int decoder_result,
+                            void *decoder_ctx,
+                            const char *out_path,
+                            AVIOContext *out_io = nullptr,
+                            transcoder_control *control = nullptr) {
+    if (decoder_result < 0) {
+        return get_decoder_init_error(decoder_result);
+    } else if (decoder_get_streams_count(decoder_ctx) != 1) {
+        decoder_free(&decoder_ctx);
+        return TRANSCODER_UNSUPPORTED_INPUT_FORMAT;
+    }
+
+    transcoder_audio_output output;
+    AVIOInterruptCB interrupt_callback{interrupt_transcoding, control};
+    int output_result = init_audio_output(decoder_ctx,
+                                          0,
+                                          out_path,
+                                          &output,
+                                          out_io,
+                                          control != nullptr ? &interrupt_callback : nullptr);
+
+    if (output_result < 0) {
+        decoder_free(&decoder_ctx);
+        return output_result;
+    }
+
+    // AAC с параметрами выхода не перекодируется, а копируется
+    bool transcoded = is_passthrough_possible(decoder_ctx, &output)
+                      ? copy_audio_packets(decoder_ctx, output.encoder_ctx, control)
+                      : transcode_audio(decoder_ctx, output.resampler_ctx, output.encoder_ctx, control);
+    int result_code = !transcoded ? TRANSCODER_UNEXPECTED_ERROR : 0;
+
+    decoder_free(&decoder_ctx);
+    free_audio_output(&output);
+
+    return result_code;
+}
+
+// Транскодирует каждый выбранный поток декодера в свой файл, декодируя потоки параллельно
+int transcode_decoded_streams(int decoder_result,
+                              void *decoder_ctx,
+                              const char **out_paths,
+                              size_t out_paths_count) {
+    if (decoder_result < 0) {
+        return get_decoder_init_error(decoder_result);
+    }
+
+    std::vector<int> outputs_indexes(decoder_get_streams_count(decoder_ctx), -1);
+    std::vector<transcoder_audio_output> outputs;
+
+    for (size_t i = 0; i < outputs_indexes.size(); ++i) {
+        if (decoder_is_stream_selected(decoder_ctx, i)) {
+            outputs_indexes[i] = static_cast<int>(outputs.size());
+            outputs.emplace_back();
+        }
+    }
+
+    if (outputs.size() != out_paths_count) {
+        decoder_free(&decoder_ctx);
+        return TRANSCODER_UNSUPPORTED_INPUT_FORMAT;
+    }
+
+    for (size_t i = 0; i < outputs_indexes.size(); ++i) {
+        if (outputs_indexes[i] < 0) {
+            continue;
+        }
+
+        int output_result = init_audio_output(decoder_ctx, i, out_paths[outputs_indexes[i]], &outputs[outputs_indexes[i]]);
+
+        if (output_result < 0) {
+            for (auto &output : outputs) {
+                free_audio_output(&output);
+            }
+
+            decoder_free(&decoder_ctx);
+            return output_result;
+        }
+    }
+
+    // Каждый поток декодируется в своем потоке, поэтому выходы между собой не пересекаются
+    int decode_result = decoder_decode_streams(decoder_ctx, [&outputs, &outputs_indexes](size_t stream_index,
+                                                                                         const uint8_t **data,
+                                                                                         size_t data_len,
+                                                                                         int64_t) {
+      transcoder_audio_output &output = outputs[outputs_indexes[stream_index]];
+      return resample_and_encode_audio(data, static_cast<int>(data_len), output.resampler_ctx, output.encoder_ctx);
+    });
+
+    int result_code = decode_result < 0 ? TRANSCODER_UNEXPECTED_ERROR : 0;
+
+    for (auto &output : outputs) {
+        if (result_code == 0 && encoder_finish_encode(output.encoder_ctx) < 0) {
+            result_code = TRANSCODER_UNEXPECTED_ERROR;
+        }
+
+        free_audio_output(&output);
+    }
+
+    decoder_free(&decoder_ctx);
+    return result_code;
+}
+
+// Сегмент аудио, кодируемый отдельным энкодером
+struct transcoder_segment {
+  int64_t index = 0;
+  // Позиции первого и следующего за последним семплов сегмента вместе с перекрытием
+  int64_t begin = 0;
+  int64_t end = 0;
+  // Границы, в которых пакеты сегмента попадают в итоговый файл
+  int64_t keep_begin = 0;
+  int64_t keep_end = 0;
+  std::vector<std::vector<uint8_t>> planes;
+  int64_t samples_count = 0;
+  std::vector<AVPacket *> packets;
+  bool encoded = false;
+  int result = 0;
+};
+
+// Состояние параллельного кодирования сегментов
+struct transcoder_segments_ctx {
+  encoder_stream_audio_codec_cfg audio_cfg{};
+  int64_t segment_length = 0;
+  int64_t overlap = 0;
+  int planes_count = 0;
+  int bytes_per_sample = 0;
+  std::mutex mutex;
+  std::condition_variable jobs_changed;
+  std::condition_variable segment_encoded;
+  std::deque<transcoder_segment *> jobs;
+  size_t max_jobs_count = 0;
+  bool jobs_finished = false;
+  std::vector<std::thread> workers;
+  // Сегменты, которые еще заполняются семплами
+  std::deque<transcoder_segment *> filling;
+  // Отправленные на кодирование сегменты в порядке записи
+  std::deque<transcoder_segment *> submitted;
+  int64_t next_segment_index = 0;
+  int64_t position = 0;
+};
+
+// Освобождает сегмент вместе с его пакетами
+void free_segment(transcoder_segment *segment) {
+    for (auto &packet : segment->packets) {
+        av_packet_free(&packet);
+    }
+
+    delete segment;
+}
+
+// Кодирует сегмент отдельным энкодером, оставляя только пакеты внутри его границ
+int encode_segment(transcoder_segments_ctx *ctx, transcoder_segment *segment) {
+    encoder_stream_audio_codec_cfg audio_cfg = ctx->audio_cfg;
+    encoder_stream_cfg stream_cfg{AV_CODEC_ID_AAC, &audio_cfg};
+    std::map<int, encoder_stream_cfg> encoders_configs{{0, stream_cfg}};
+    void *encoder_ctx;
+
+    int result = encoder_init_with_packet_handler(&encoder_ctx, encoders_configs, [segment](int, AVPacket *packet) {
+      int64_t position = segment->begin + packet->pts;
+
+      if (position < segment->keep_begin || position >= segment->keep_end) {
+          return true;
+      }
+
+      AVPacket *kept_packet = av_packet_alloc();
+      av_packet_move_ref(kept_packet, packet);
+      kept_packet->pts = position;
+      kept_packet->dts = position;
+      segment->packets.push_back(kept_packet);
+      return true;
+    });
+
+    if (result < 0) {
+        return TRANSCODER_UNEXPECTED_ERROR;
+    }
+
+    int frame_size = encoder_get_samples_count_per_frame(encoder_ctx, 0);
+    std::vector<uint8_t *> planes(ctx->planes_count);
+
+    for (int64_t offset = 0; offset < segment->samples_count && result >= 0; offset += frame_size) {
+        int64_t samples_count = std::min<int64_t>(frame_size, segment->samples_count - offset);
+
+        for (int i = 0; i < ctx->planes_count; ++i) {
+            planes[i] = segment->planes[i].data() + offset * ctx->bytes_per_sample;
+        }
+
+        result = encoder_encode(encoder_ctx, 0, planes.data(), samples_count * ctx->bytes_per_sample);
+    }
+
+    if (result >= 0) {
+        result = encoder_finish_encode(encoder_ctx);
+    }
+
+    encoder_free(&encoder_ctx);
+
+    // Семплы больше не нужны, пакеты ждут записи в итоговый файл
+    segment->planes = std::vector<std::vector<uint8_t>>();
+    return result < 0 ? TRANSCODER_UNEXPECTED_ERROR : 0;
+}
+
+// Кодирует сегменты из очереди, пока она не будет закрыта
+void run_segments_worker(transcoder_segments_ctx *ctx, scheduler_priority priority) {
+    scheduler_slot_guard slot(priority);
+
     while (true) {
-        int res = decoder_decode(dec_ctx, [&sampler_ctx, &enc_ctx, &buf_ctx](const uint8_t **data,
-                                                                             int data_len, auto) {
-          return resample_and_encode_audio(data, data_len, sampler_ctx, enc_ctx, buf_ctx);
-        });
+        transcoder_segment *segment;
+
+        {
+            std::unique_lock<std::mutex> lock(ctx->mutex);
+            scheduler_wait(lock, ctx->jobs_changed, [ctx] { return ctx->jobs_finished || !ctx->jobs.empty(); });
 
-        if (res < 0) {
-            if (res != DECODER_END_OF_STREAM_ERROR) {
-                return false;
-            } else {
-                break;
+            if (ctx->jobs.empty()) {
+                return;
             }
+
+            segment = ctx->jobs.front();
+            ctx->jobs.pop_front();
+            ctx->jobs_changed.notify_all();
         }
+
+        int result = encode_segment(ctx, segment);
+
+        std::lock_guard<std::mutex> lock(ctx->mutex);
+        segment->result = result;
+        segment->encoded = true;
+        ctx->segment_encoded.notify_all();
     }
+}
 
-    // Транскодирование считается успешным, если в итоге в буффере ничего не осталось, либо оставшееся было закодировано.
-    size_t need_bytes_at_encoder = get_need_bytes_count_at_encoder(enc_ctx);
-    size_t remained_bytes;
+// Отправляет заполненный сегмент на кодирование, ожидая места в очереди
+void submit_segment(transcoder_segments_ctx *ctx, transcoder_segment *segment) {
+    std::unique_lock<std::mutex> lock(ctx->mutex);
+    scheduler_wait(lock, ctx->jobs_changed, [ctx] { return ctx->jobs.size() < ctx->max_jobs_count; });
+    ctx->jobs.push_back(segment);
+    ctx->submitted.push_back(segment);
+    ctx->jobs_changed.notify_all();
+}
 
-    while ((remained_bytes = buffer_get_colums_count(buf_ctx)) > 0) {
-        size_t block_size = std::min(need_bytes_at_encoder, remained_bytes);
+// Записывает закодированные сегменты в итоговый файл по порядку.
+// Без ожидания записывает только уже готовые сегменты.
+int write_encoded_segments(transcoder_segments_ctx *ctx, void *encoder_ctx, bool wait) {
+    while (true) {
+        transcoder_segment *segment;
 
-        if (!encode_audio(buf_ctx, enc_ctx, block_size)) {
-            return false;
+        {
+            std::unique_lock<std::mutex> lock(ctx->mutex);
+
+            if (ctx->submitted.empty()) {
+                return 0;
+            } else if (wait) {
+                scheduler_wait(lock, ctx->segment_encoded, [ctx] { return ctx->submitted.front()->encoded; });
+            } else if (!ctx->submitted.front()->encoded) {
+                return 0;
+            }
+
+            segment = ctx->submitted.front();
+            ctx->submitted.pop_front();
+        }
+
+        int result = segment->result;
+
+        for (size_t i = 0; i < segment->packets.size() && result >= 0; ++i) {
+            result = encoder_write_packet(encoder_ctx, 0, segment->packets[i]);
+        }
+
+        free_segment(segment);
+
+        if (result < 0) {
+            return TRANSCODER_UNEXPECTED_ERROR;
         }
     }
+}
+
+// Раскладывает семплы по сегментам, в границы которых они попадают, и отправляет заполненные сегменты
+void distribute_samples(transcoder_segments_ctx *ctx, uint8_t **data, int64_t samples_count) {
+    int64_t from = ctx->position;
+    int64_t to = ctx->position + samples_count;
+
+    while (std::max<int64_t>(0, ctx->next_segment_index * ctx->segment_length - ctx->overlap) < to) {
+        auto segment = new transcoder_segment();
+        segment->index = ctx->next_segment_index++;
+        segment->begin = std::max<int64_t>(0, segment->index * ctx->segment_length - ctx->overlap);
+        segment->end = (segment->index + 1) * ctx->segment_length + ctx->overlap;
+        segment->keep_begin = segment->index == 0 ? INT64_MIN : segment->index * ctx->segment_length;
+        segment->keep_end = (segment->index + 1) * ctx->segment_length;
+        segment->planes.resize(ctx->planes_count);
+        ctx->filling.push_back(segment);
+    }
+
+    while (!ctx->filling.empty()) {
+        transcoder_segment *segment = ctx->filling.front();
+        int64_t copy_from = std::max(from, segment->begin);
+        int64_t copy_to = std::min(to, segment->end);
 
-    // Также необходимо, чтобы успешно выполнилось завершение процесса кодирования.
-    return encoder_finish_encode(enc_ctx) >= 0;
+        for (int i = 0; i < ctx->planes_count && copy_from < copy_to; ++i) {
+            segment->planes[i].insert(segment->planes[i].end(),
+                                      data[i] + (copy_from - from) * ctx->bytes_per_sample,
+                                      data[i] + (copy_to - from) * ctx->bytes_per_sample);
+        }
+
+        segment->samples_count += std::max<int64_t>(copy_to - copy_from, 0);
+
+        if (to < segment->end) {
+            break;
+        }
+
+        ctx->filling.pop_front();
+        submit_segment(ctx, segment);
+    }
+
+    // Досыпаем семплы в следующие сегменты, которые еще не заполнены
+    for (size_t i = 1; i < ctx->filling.size(); ++i) {
+        transcoder_segment *segment = ctx->filling[i];
+        int64_t copy_from = std::max(from, segment->begin);
+
+        for (int j = 0; j < ctx->planes_count && copy_from < to; ++j) {
+            segment->planes[j].insert(segment->planes[j].end(),
+                                      data[j] + (copy_from - from) * ctx->bytes_per_sample,
+                                      data[j] + (to - from) * ctx->bytes_per_sample);
+        }
+
+        segment->samples_count += std::max<int64_t>(to - copy_from, 0);
+    }
+
+    ctx->position = to;
+}
+
+// Отправляет на кодирование последние сегменты. Сегменты, в которых нет семплов для итогового файла, отбрасываются.
+void submit_last_segments(transcoder_segments_ctx *ctx) {
+    int64_t last_index = ctx->position > 0 ? (ctx->position - 1) / ctx->segment_length : 0;
+
+    for (auto &segment : ctx->filling) {
+        if (segment->index > last_index) {
+            free_segment(segment);
+            continue;
+        }
+
+        if (segment->index == last_index) {
+            segment->keep_end = INT64_MAX;
+        }
+
+        submit_segment(ctx, segment);
+    }
+
+    ctx->filling.clear();
+}
+
+// Выбирает длину сегмента в семплах, кратную размеру фрейма энкодера. 0, если делить запись на сегменты не нужно.
+int64_t select_segment_length(int64_t length_in_us, int sample_rate, int frame_size, int threads_count) {
+    if (threads_count <= 1 || frame_size <= 0 || length_in_us <= 0) {
+        return 0;
+    }
+
+    int64_t samples_count = av_rescale(length_in_us, sample_rate, AV_TIME_BASE);
+    int64_t segment_length = (int64_t) TRANSCODER_SEGMENT_LENGTH * sample_rate;
+    segment_length = (segment_length + frame_size - 1) / frame_size * frame_size;
+
+    return segment_length < samples_count ? segment_length : 0;
+}
+
+// Декодирует и ресемплит аудио в одном потоке, а кодирует его сегментами в нескольких потоках
+bool transcode_audio_in_segments(void *dec_ctx,
+                                 transcoder_audio_output *output,
+                                 int64_t segment_length,
+                                 int threads_count) {
+    transcoder_segments_ctx ctx;
+    ctx.audio_cfg = *output->audio_cfg;
+    ctx.segment_length = segment_length;
+    ctx.overlap = (int64_t) TRANSCODER_SEGMENT_OVERLAP_FRAMES * encoder_get_samples_count_per_frame(output->encoder_ctx, 0);
+    ctx.planes_count = av_sample_fmt_is_planar(ctx.audio_cfg.sample_format) ? ctx.audio_cfg.channels_count : 1;
+    ctx.bytes_per_sample = encoder_get_bytes_per_sample_count(output->encoder_ctx, 0);
+    ctx.max_jobs_count = threads_count;
+
+    for (int i = 0; i < threads_count; ++i) {
+        ctx.workers.emplace_back(run_segments_worker, &ctx, scheduler_get_thread_priority());
+    }
+
+    std::vector<std::vector<uint8_t>> resampled(ctx.planes_count);
+    std::vector<uint8_t *> resampled_planes(ctx.planes_count);
+    bool result = true;
+
+    while (result) {
+        int res = decoder_decode(dec_ctx, [&](const uint8_t **data, size_t data_len, int64_t) {
+          int need_bytes = resampler_get_need_bytes_count(output->resampler_ctx, static_cast<int>(data_len));
+
+          for (int i = 0; i < ctx.planes_count; ++i) {
+              resampled[i].resize(std::max<size_t>(resampled[i].size(), need_bytes));
+              resampled_planes[i] = resampled[i].data();
+          }
+
+          int resampled_bytes = resampler_resample(output->resampler_ctx,
+                                                   data,
+                                                   static_cast<int>(data_len),
+                                                   resampled_planes.data());
+
+          if (resampled_bytes < 0) {
+              return false;
+          }
+
+          distribute_samples(&ctx, resampled_planes.data(), resampled_bytes / ctx.bytes_per_sample);
+          return write_encoded_segments(&ctx, output->encoder_ctx, false) >= 0;
+        });
+
+        if (res == DECODER_END_OF_STREAM_ERROR) {
+            break;
+        } else if (res < 0) {
+            result = false;
+        }
+    }
+
+    if (result) {
+        submit_last_segments(&ctx);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(ctx.mutex);
+        ctx.jobs_finished = true;
+        ctx.jobs_changed.notify_all();
+    }
+
+    // Дописываем сегменты по порядку, пока остальные еще кодируются
+    if (result && write_encoded_segments(&ctx, output->encoder_ctx, true) < 0) {
+        result = false;
+    }
+
+    for (auto &worker : ctx.workers) {
+        scheduler_join(worker);
+    }
+
+    for (auto &segment : ctx.filling) {
+        free_segment(segment);
+    }
+
+    for (auto &segment : ctx.submitted) {
+        free_segment(segment);
+    }
+
+    return result && encoder_finish_encode(output->encoder_ctx) >= 0;
 }
 
 extern "C"
@@ -87,6 +828,180 @@ int transcoder_do_audio(const char *in_path,
                         const char *out_path,
                         int64_t start_moment_in_ms,
                         int64_t end_moment_in_ms) {
+    scheduler_slot_guard slot;
+    void *decoder_ctx;
+    std::unordered_set<AVMediaType> decode_media_types{AVMEDIA_TYPE_AUDIO};
+    int decoder_result = decoder_init(&decoder_ctx,
+                                      in_path,
+                                      start_moment_in_ms,
+                                      end_moment_in_ms,
+                                      decode_media_types);
+
+    return transcode_decoded_audio(decoder_result, decoder_ctx, out_path);
+}
+
+extern "C"
+int transcoder_do_audio_from_memory(const uint8_t *in_data,
+                                    size_t in_size,
+                                    const char *out_path,
+                                    int64_t start_moment_in_ms,
+                                    int64_t end_moment_in_ms) {
+    scheduler_slot_guard slot;
+    void *decoder_ctx;
+    std::unordered_set<AVMediaType> decode_media_types{AVMEDIA_TYPE_AUDIO};
+    int decoder_result = decoder_init_from_memory(&decoder_ctx,
+                                                  in_data,
+                                                  in_size,
+                                                  start_moment_in_ms,
+                                                  end_moment_in_ms,
+                                                  decode_media_types);
+
+    return transcode_decoded_audio(decoder_result, decoder_ctx, out_path);
+}
+
+extern "C"
+int transcoder_do_audio_to_callback(const char *in_path,
+                                    transcoder_write_callback write_data,
+                                    void *opaque,
+                                    int64_t start_moment_in_ms,
+                                    int64_t end_moment_in_ms,
+                                    int io_buffer_size) {
+    scheduler_slot_guard slot;
+
+    if (write_data == nullptr) {
+        return TRANSCODER_UNEXPECTED_ERROR;
+    }
+
+    AVIOContext *out_io;
+    int io_result = io_open_callback_output(&out_io, [write_data, opaque](const uint8_t *data, size_t size) {
+      return write_data(opaque, data, size);
+    }, io_buffer_size);
+
+    if (io_result < 0) {
+        return TRANSCODER_UNEXPECTED_ERROR;
+    }
+
+    void *decoder_ctx;
+    std::unordered_set<AVMediaType> decode_media_types{AVMEDIA_TYPE_AUDIO};
+    int decoder_result = decoder_init(&decoder_ctx,
+                                      in_path,
+                                      start_moment_in_ms,
+                                      end_moment_in_ms,
+                                      decode_media_types);
+    int result = transcode_decoded_audio(decoder_result, decoder_ctx, nullptr, out_io);
+
+    io_free_output(&out_io);
+    return result;
+}
+
+extern "C"
+int transcoder_do_audio_to_memory(const char *in_path,
+                                  uint8_t **out_data,
+                                  size_t *out_size,
+                                  int64_t start_moment_in_ms,
+                                  int64_t end_moment_in_ms,
+                                  int io_buffer_size) {
+    scheduler_slot_guard slot;
+    AVIOContext *out_io;
+
+    if (io_open_memory_output(&out_io, io_buffer_size) < 0) {
+        return TRANSCODER_UNEXPECTED_ERROR;
+    }
+
+    void *decoder_ctx;
+    std::unordered_set<AVMediaType> decode_media_types{AVMEDIA_TYPE_AUDIO};
+    int decoder_result = decoder_init(&decoder_ctx,
+                                      in_path,
+                                      start_moment_in_ms,
+                                      end_moment_in_ms,
+                                      decode_media_types);
+    int result = transcode_decoded_audio(decoder_result, decoder_ctx, nullptr, out_io);
+
+    if (result == 0 && io_take_memory_output(out_io, out_data, out_size) < 0) {
+        result = TRANSCODER_UNEXPECTED_ERROR;
+    }
+
+    io_free_output(&out_io);
+    return result;
+}
+
+extern "C"
+int transcoder_do_audio_fd(int in_fd,
+                           int out_fd,
+                           int64_t start_moment_in_ms,
+                           int64_t end_moment_in_ms,
+                           int io_buffer_size) {
+    scheduler_slot_guard slot;
+    AVIOContext *out_io;
+
+    if (io_open_fd_output(&out_io, out_fd, io_buffer_size) < 0) {
+        return TRANSCODER_UNEXPECTED_ERROR;
+    }
+
+    void *decoder_ctx;
+    std::unordered_set<AVMediaType> decode_media_types{AVMEDIA_TYPE_AUDIO};
+    int decoder_result = decoder_init_from_fd(&decoder_ctx,
+                                              in_fd,
+                                              start_moment_in_ms,
+                                              end_moment_in_ms,
+                                              decode_media_types);
+    int result = transcode_decoded_audio(decoder_result, decoder_ctx, nullptr, out_io);
+
+    io_free_output(&out_io);
+    return result;
+}
+
+extern "C"
+void transcoder_free_output_data(uint8_t **data_ref) {
+    av_freep(data_ref);
+}
+
+extern "C"
+int transcoder_do_audio_streams(const char *in_path,
+                                const char **out_paths,
+                                size_t out_paths_count,
+                                int64_t start_moment_in_ms,
+                                int64_t end_moment_in_ms) {
+    scheduler_slot_guard slot;
+    void *decoder_ctx;
+    std::unordered_set<AVMediaType> decode_media_types{AVMEDIA_TYPE_AUDIO};
+    int decoder_result = decoder_init(&decoder_ctx,
+                                      in_path,
+                                      start_moment_in_ms,
+                                      end_moment_in_ms,
+                                      decode_media_types);
+
+    return transcode_decoded_streams(decoder_result, decoder_ctx, out_paths, out_paths_count);
+}
+
+extern "C"
+int transcoder_do_audio_stream(const char *in_path,
+                               const char *out_path,
+                               int stream_index,
+                               int64_t start_moment_in_ms,
+                               int64_t end_moment_in_ms) {
+    scheduler_slot_guard slot;
+    void *decoder_ctx;
+    decoder_options options;
+    options.stream_index = stream_index;
+    std::unordered_set<AVMediaType> decode_media_types{AVMEDIA_TYPE_AUDIO};
+    int decoder_result = decoder_init(&decoder_ctx,
+                                      in_path,
+                                      start_moment_in_ms,
+                                      end_moment_in_ms,
+                                      decode_media_types,
+                                      options);
+
+    return transcode_decoded_streams(decoder_result, decoder_ctx, &out_path, 1);
+}
+
+extern "C"
+int transcoder_do_audio_parallel(const char *in_path,
+                                 const char *out_path,
+                                 int64_t start_moment_in_ms,
+                                 int64_t end_moment_in_ms,
+                                 int threads_count) {
+    scheduler_slot_guard slot;
     void *decoder_ctx;
     std::unordered_set<AVMediaType> decode_media_types{AVMEDIA_TYPE_AUDIO};
     int decoder_result = decoder_init(&decoder_ctx,
@@ -96,67 +1011,229 @@ int transcoder_do_audio(const char *in_path,
                                       decode_media_types);
 
     if (decoder_result < 0) {
-        switch (decoder_result) {
-            case DECODER_UNSUPPORTED_MEDIA_TYPE_ERROR:
-            case DECODER_NOT_ALL_CODECS_FOUND_ERROR:return TRANSCODER_UNSUPPORTED_INPUT_FORMAT;
-            case DECODER_INPUT_OPENING_ERROR:return TRANSCODER_MAYBE_FILE_NOT_FOUND;
-            default:return TRANSCODER_UNEXPECTED_ERROR;
-        }
+        return get_decoder_init_error(decoder_result);
     } else if (decoder_get_streams_count(decoder_ctx) != 1) {
         decoder_free(&decoder_ctx);
         return TRANSCODER_UNSUPPORTED_INPUT_FORMAT;
     }
 
-    int in_sample_rate = decoder_get_sample_rate(decoder_ctx, 0);
-    int in_channels_count = decoder_get_channels_count(decoder_ctx, 0);
-    uint64_t in_channel_layout = decoder_get_channel_layout(decoder_ctx, 0);
-    AVSampleFormat in_sample_format = decoder_get_sample_format(decoder_ctx, 0);
-    auto *audio_cfg = new encoder_stream_audio_codec_cfg{
-        in_sample_rate, in_channels_count, in_channel_layout, in_sample_format};
-
-    // Инициализируем энкодер
-    void *encoder_ctx;
-    encoder_stream_cfg stream_cfg{AV_CODEC_ID_AAC, audio_cfg};
-    std::map<int, encoder_stream_cfg> encoders_configs{{0, stream_cfg}};
-    int encoder_result = encoder_init(&encoder_ctx, out_path, encoders_configs);
+    transcoder_audio_output output;
+    int output_result = init_audio_output(decoder_ctx, 0, out_path, &output);
 
-    if (encoder_result < 0) {
+    if (output_result < 0) {
         decoder_free(&decoder_ctx);
-        delete audio_cfg;
+        return output_result;
+    }
 
-        return encoder_result == ENCODER_OUTPUT_STREAM_ERROR
-               ? TRANSCODER_MAYBE_FILE_ALREADY_EXIST
-               : TRANSCODER_UNEXPECTED_ERROR;
+    if (threads_count <= 0) {
+        threads_count = static_cast<int>(std::thread::hardware_concurrency());
     }
 
-    void *resampler_ctx;
-    int resampler_result = resampler_init(&resampler_ctx,
-                                          static_cast<int64_t>(in_channel_layout),
-                                          static_cast<int64_t>(audio_cfg->channel_layout),
-                                          in_sample_format,
-                                          audio_cfg->sample_format,
-                                          in_sample_rate,
-                                          audio_cfg->sample_rate,
-                                          in_channels_count);
+    int64_t length_in_us = end_moment_in_ms != 0
+                           ? (end_moment_in_ms - start_moment_in_ms) * 1000
+                           : decoder_get_duration_in_us(decoder_ctx) - start_moment_in_ms * 1000;
+    int64_t segment_length = select_segment_length(length_in_us,
+                                                   output.audio_cfg->sample_rate,
+                                                   encoder_get_samples_count_per_frame(output.encoder_ctx, 0),
+                                                   threads_count);
 
-    if (resampler_result < 0) {
+    // Короткие записи быстрее закодировать целиком, чем делить на сегменты
+    bool transcoded = segment_length == 0
+                      ? transcode_audio(decoder_ctx, output.resampler_ctx, output.encoder_ctx)
+                      : transcode_audio_in_segments(decoder_ctx, &output, segment_length, threads_count);
+
+    decoder_free(&decoder_ctx);
+    free_audio_output(&output);
+
+    return transcoded ? 0 : TRANSCODER_UNEXPECTED_ERROR;
+}
+
+extern "C"
+int transcoder_do_audio_pipelined(const char *in_path,
+                                  const char *out_path,
+                                  int64_t start_moment_in_ms,
+                                  int64_t end_moment_in_ms,
+                                  int queue_capacity,
+                                  transcoder_pipeline_stats *stats) {
+    scheduler_slot_guard slot;
+    void *decoder_ctx;
+    std::unordered_set<AVMediaType> decode_media_types{AVMEDIA_TYPE_AUDIO};
+    int decoder_result = decoder_init(&decoder_ctx,
+                                      in_path,
+                                      start_moment_in_ms,
+                                      end_moment_in_ms,
+                                      decode_media_types);
+
+    if (decoder_result < 0) {
+        return get_decoder_init_error(decoder_result);
+    } else if (decoder_get_streams_count(decoder_ctx) != 1) {
         decoder_free(&decoder_ctx);
-        encoder_free(&encoder_ctx);
-        delete audio_cfg;
-        return TRANSCODER_UNEXPECTED_ERROR;
+        return TRANSCODER_UNSUPPORTED_INPUT_FORMAT;
+    }
+
+    transcoder_audio_output output;
+    int output_result = init_audio_output(decoder_ctx, 0, out_path, &output);
+
+    if (output_result < 0) {
+        decoder_free(&decoder_ctx);
+        return output_result;
     }
 
-    void *encode_buffer;
-    buffer_allocate(&encode_buffer, audio_cfg->channels_count);
-    int result_code = !transcode_audio(decoder_ctx, resampler_ctx, encoder_ctx, encode_buffer)
-                      ? TRANSCODER_UNEXPECTED_ERROR
-                      : 0;
+    bool transcoded = transcode_audio(decoder_ctx,
+                                      output.resampler_ctx,
+                                      output.encoder_ctx,
+                                      nullptr,
+                                      queue_capacity > 0 ? queue_capacity : TRANSCODER_PIPELINE_QUEUE_CAPACITY,
+                                      stats);
 
     decoder_free(&decoder_ctx);
-    encoder_free(&encoder_ctx);
-    resampler_free(&resampler_ctx);
-    buffer_free(&encode_buffer);
-    delete audio_cfg;
+    free_audio_output(&output);
 
-    return result_code;
+    return transcoded ? 0 : TRANSCODER_UNEXPECTED_ERROR;
+}
+
+extern "C"
+int transcoder_do_audio_batch(const transcoder_job *jobs,
+                              size_t jobs_count,
+                              int *results,
+                              int workers_count,
+                              transcoder_batch_report *report) {
+    if ((jobs == nullptr || results == nullptr) && jobs_count != 0) {
+        return TRANSCODER_UNEXPECTED_ERROR;
+    }
+
+    void *pool_ctx;
+
+    if (job_pool_init(&pool_ctx, workers_count) < 0) {
+        return TRANSCODER_UNEXPECTED_ERROR;
+    }
+
+    // Задачи пакета ожидают слотов планировщика с приоритетом вызвавшего потока
+    scheduler_priority priority = scheduler_get_thread_priority();
+    std::atomic<int64_t> jobs_time_us{0};
+    int64_t started_at = get_monotonic_time_us();
+
+    for (size_t i = 0; i < jobs_count; ++i) {
+        job_pool_submit(pool_ctx, [&jobs, &results, &jobs_time_us, priority, i] {
+          scheduler_set_thread_priority(priority);
+          int64_t job_started_at = get_monotonic_time_us();
+          results[i] = transcoder_do_audio(jobs[i].in_path,
+                                           jobs[i].out_path,
+                                           jobs[i].start_moment_in_ms,
+                                           jobs[i].end_moment_in_ms);
+          jobs_time_us += get_monotonic_time_us() - job_started_at;
+        });
+    }
+
+    job_pool_wait(pool_ctx);
+
+    if (report != nullptr) {
+        job_pool_stats stats{};
+        job_pool_get_stats(pool_ctx, &stats);
+
+        report->workers_count = stats.workers_count;
+        report->jobs_count = static_cast<int64_t>(jobs_count);
+        report->failed_jobs_count = std::count_if(results, results + jobs_count, [](int result) {
+          return result < 0;
+        });
+        report->wall_time_us = get_monotonic_time_us() - started_at;
+        report->jobs_time_us = jobs_time_us;
+        report->steals_count = stats.steals_count;
+        report->jobs_per_second = report->wall_time_us > 0
+                                  ? static_cast<double>(jobs_count) * 1000000 / static_cast<double>(report->wall_time_us)
+                                  : 0;
+    }
+
+    job_pool_free(&pool_ctx);
+    return 0;
+}
+
+// Выполняет асинхронное транскодирование в его потоке
+void run_async_transcoding(transcoder_async_ctx *ctx) {
+    transcoder_control *control = &ctx->control;
+    scheduler_set_thread_priority(ctx->priority);
+
+    // Отмененное в очереди транскодирование завершается, не дожидаясь слота
+    if (scheduler_acquire_interruptible(interrupt_transcoding, control) < 0) {
+        ctx->result = TRANSCODER_CANCELLED_ERROR;
+        ctx->finished = true;
+        return;
+    }
+
+    void *decoder_ctx;
+    decoder_options options;
+    options.interrupt_callback = AVIOInterruptCB{interrupt_transcoding, control};
+    std::unordered_set<AVMediaType> decode_media_types{AVMEDIA_TYPE_AUDIO};
+    int decoder_result = decoder_init(&decoder_ctx,
+                                      ctx->in_path.c_str(),
+                                      ctx->start_moment_in_ms,
+                                      ctx->end_moment_in_ms,
+                                      decode_media_types,
+                                      options);
+
+    if (decoder_result >= 0) {
+        control->duration_us = ctx->end_moment_in_ms != 0
+                               ? (ctx->end_moment_in_ms - ctx->start_moment_in_ms) * 1000
+                               : std::max<int64_t>(decoder_get_duration_in_us(decoder_ctx) - control->start_us, 0);
+    }
+
+    int result = transcode_decoded_audio(decoder_result, decoder_ctx, ctx->out_path.c_str(), nullptr, control);
+    scheduler_release();
+
+    ctx->result = result < 0 && control->cancelled ? TRANSCODER_CANCELLED_ERROR : result;
+    ctx->finished = true;
+}
+
+extern "C"
+int transcoder_async_start(void **ctx_ref,
+                           const char *in_path,
+                           const char *out_path,
+                           int64_t start_moment_in_ms,
+                           int64_t end_moment_in_ms) {
+    if (in_path == nullptr || out_path == nullptr) {
+        return TRANSCODER_UNEXPECTED_ERROR;
+    }
+
+    auto ctx = new transcoder_async_ctx();
+    ctx->in_path = in_path;
+    ctx->out_path = out_path;
+    ctx->start_moment_in_ms = start_moment_in_ms;
+    ctx->end_moment_in_ms = end_moment_in_ms;
+    ctx->control.start_us = start_moment_in_ms * 1000;
+    ctx->priority = scheduler_get_thread_priority();
+    ctx->thread = std::thread(run_async_transcoding, ctx);
+
+    *ctx_ref = ctx;
+    return 0;
+}
+
+extern "C"
+int transcoder_async_poll(void *ctx_ref, transcoder_progress *progress) {
+    auto casted_ctx = static_cast<transcoder_async_ctx *>(ctx_ref);
+    bool finished = casted_ctx->finished;
+
+    if (progress != nullptr) {
+        progress->decoded_us = casted_ctx->control.decoded_us;
+        progress->duration_us = casted_ctx->control.duration_us;
+    }
+
+    return finished ? 1 : 0;
+}
+
+extern "C"
+void transcoder_async_cancel(void *ctx_ref) {
+    static_cast<transcoder_async_ctx *>(ctx_ref)->control.cancelled = true;
+    scheduler_wake_waiters();
+}
+
+extern "C"
+int transcoder_async_join(void **ctx_ref) {
+    auto casted_ctx = static_cast<transcoder_async_ctx *>(*ctx_ref);
+    casted_ctx->thread.join();
+
+    int result = casted_ctx->result;
+    delete casted_ctx;
+    *ctx_ref = nullptr;
+
+    return result;
 }
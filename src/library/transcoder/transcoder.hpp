@@ -1,13 +1,177 @@
 #ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_TRANSCODER_TRANSCODER_HPP_
 #define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_TRANSCODER_TRANSCODER_HPP_
 
+#include <cstddef>
 #include <cstdint>
 
-// Запускает транскодирование аудио-записи
+// Счетчики стадии конвейера транскодирования
+struct transcoder_stage_stats {
+  int64_t frames_count;
+  // Время обработки фреймов в микросекундах
+  int64_t busy_time_us;
+  // Время ожидания фреймов от предыдущей стадии или места в очереди следующей в микросекундах
+  int64_t idle_time_us;
+};
+
+// Счетчики стадий конвейера транскодирования. Ресемплинг выполняется в потоке кодирования прямо
+// в плоскости энкодера, поэтому у него нет времени ожидания, а его время не входит во время кодирования.
+struct transcoder_pipeline_stats {
+  transcoder_stage_stats decoding;
+  transcoder_stage_stats resampling;
+  transcoder_stage_stats encoding;
+};
+
+// Задача пакетного транскодирования
+struct transcoder_job {
+  const char *in_path;
+  const char *out_path;
+  int64_t start_moment_in_ms;
+  int64_t end_moment_in_ms;
+};
+
+// Итоги пакетного транскодирования
+struct transcoder_batch_report {
+  int32_t workers_count;
+  int64_t jobs_count;
+  int64_t failed_jobs_count;
+  // Время выполнения всего пакета в микросекундах
+  int64_t wall_time_us;
+  // Суммарное время выполнения задач в микросекундах
+  int64_t jobs_time_us;
+  // Сколько задач было взято рабочими потоками из чужих очередей
+  int64_t steals_count;
+  double jobs_per_second;
+};
+
+// Прогресс асинхронного транскодирования
+struct transcoder_progress {
+  // Декодированная часть нарезки в микросекундах
+  int64_t decoded_us;
+  // Длительность нарезки в микросекундах, 0 пока она неизвестна
+  int64_t duration_us;
+};
+
+// Запускает транскодирование аудио-записи. Декодирование выполняется в отдельном потоке параллельно
+// с ресемплингом и кодированием. Запись, уже сжатая в AAC LC с той же частотой и
+// количеством каналов, при запросе всего файла не перекодируется: ее пакеты копируются в выход.
 extern "C"
 int transcoder_do_audio(const char *in_path,
                         const char *out_path,
                         int64_t start_moment_in_ms,
                         int64_t end_moment_in_ms);
 
+// Запускает транскодирование аудио-записи, находящейся в памяти
+extern "C"
+int transcoder_do_audio_from_memory(const uint8_t *in_data,
+                                    size_t in_size,
+                                    const char *out_path,
+                                    int64_t start_moment_in_ms,
+                                    int64_t end_moment_in_ms);
+
+// Обработчик закодированных данных. Возвращает false, чтобы прервать транскодирование.
+typedef bool (*transcoder_write_callback)(void *opaque, const uint8_t *data, size_t size);
+
+// Транскодирует аудио-запись, передавая закодированный ADTS в обработчик по мере заполнения
+// буффера записи указанного размера. При нулевом размере используется размер по умолчанию.
+extern "C"
+int transcoder_do_audio_to_callback(const char *in_path,
+                                    transcoder_write_callback write_data,
+                                    void *opaque,
+                                    int64_t start_moment_in_ms,
+                                    int64_t end_moment_in_ms,
+                                    int io_buffer_size);
+
+// Транскодирует аудио-запись в память. Результат освобождается через transcoder_free_output_data.
+extern "C"
+int transcoder_do_audio_to_memory(const char *in_path,
+                                  uint8_t **out_data,
+                                  size_t *out_size,
+                                  int64_t start_moment_in_ms,
+                                  int64_t end_moment_in_ms,
+                                  int io_buffer_size);
+
+// Транскодирует аудио-поток из файлового дескриптора в файловый дескриптор, например между каналами.
+// Вход читается последовательно без перемотки, ADTS пишется по мере кодирования каждого пакета
+// через буффер записи указанного размера. Дескрипторы не закрываются.
+extern "C"
+int transcoder_do_audio_fd(int in_fd,
+                           int out_fd,
+                           int64_t start_moment_in_ms,
+                           int64_t end_moment_in_ms,
+                           int io_buffer_size);
+
+// Освобождает данные, выданные transcoder_do_audio_to_memory
+extern "C"
+void transcoder_free_output_data(uint8_t **data_ref);
+
+// Транскодирует каждый аудио-поток записи в свой файл, декодируя потоки параллельно.
+// Количество путей должно совпадать с количеством аудио-потоков.
+extern "C"
+int transcoder_do_audio_streams(const char *in_path,
+                                const char **out_paths,
+                                size_t out_paths_count,
+                                int64_t start_moment_in_ms,
+                                int64_t end_moment_in_ms);
+
+// Транскодирует аудио-поток записи с указанным индексом
+extern "C"
+int transcoder_do_audio_stream(const char *in_path,
+                               const char *out_path,
+                               int stream_index,
+                               int64_t start_moment_in_ms,
+                               int64_t end_moment_in_ms);
+
+// Транскодирует аудио-запись, декодируя ее в одном потоке, а кодируя сегментами параллельно
+// в указанном количестве потоков. При 0 потоков их количество выбирается по числу ядер.
+// Короткие записи кодируются последовательно.
+extern "C"
+int transcoder_do_audio_parallel(const char *in_path,
+                                 const char *out_path,
+                                 int64_t start_moment_in_ms,
+                                 int64_t end_moment_in_ms,
+                                 int threads_count);
+
+// Транскодирует аудио-запись тем же конвейером, что и transcoder_do_audio: декодирование выполняется
+// в отдельном потоке, связанном с ресемплингом и кодированием ограниченной очередью фреймов указанной емкости.
+// При нулевой емкости используется емкость по умолчанию. Счетчики стадий записываются в stats, если он передан.
+extern "C"
+int transcoder_do_audio_pipelined(const char *in_path,
+                                  const char *out_path,
+                                  int64_t start_moment_in_ms,
+                                  int64_t end_moment_in_ms,
+                                  int queue_capacity,
+                                  transcoder_pipeline_stats *stats);
+
+// Транскодирует пакет записей на пуле рабочих потоков с кражей задач. При 0 потоков их количество
+// выбирается по числу ядер. Код результата каждой задачи записывается в results, итоги - в report, если он передан.
+extern "C"
+int transcoder_do_audio_batch(const transcoder_job *jobs,
+                              size_t jobs_count,
+                              int *results,
+                              int workers_count,
+                              transcoder_batch_report *report);
+
+// Запускает транскодирование аудио-записи в отдельном потоке и выдает его контекст.
+// Контекст освобождается только через transcoder_async_join.
+extern "C"
+int transcoder_async_start(void **ctx_ref,
+                           const char *in_path,
+                           const char *out_path,
+                           int64_t start_moment_in_ms,
+                           int64_t end_moment_in_ms);
+
+// Выдает прогресс без ожидания. Возвращает 1, если транскодирование закончено, и 0, если еще выполняется.
+extern "C"
+int transcoder_async_poll(void *ctx_ref, transcoder_progress *progress);
+
+// Просит остановить транскодирование. Остановка происходит перед следующим пакетом
+// или прерыванием блокирующего ввода-вывода, частично записанный файл удаляется.
+extern "C"
+void transcoder_async_cancel(void *ctx_ref);
+
+// Ожидает завершения транскодирования, освобождает контекст и выдает код результата.
+// Отмененное транскодирование завершается с TRANSCODER_CANCELLED_ERROR.
+extern "C"
+int transcoder_async_join(void **ctx_ref);
+
 #endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_TRANSCODER_TRANSCODER_HPP_
\ No newline at end of file
@@ -0,0 +1,34 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_TRANSCODER_TRANSCODER_CONTEXT_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_TRANSCODER_TRANSCODER_CONTEXT_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "../scheduler/scheduler.hpp"
+
+// Состояние транскодирования, доступное другим потокам
+struct transcoder_control {
+  std::atomic<bool> cancelled{false};
+  // Начало нарезки в микросекундах, от которого отсчитывается прогресс
+  int64_t start_us = 0;
+  std::atomic<int64_t> decoded_us{0};
+  std::atomic<int64_t> duration_us{0};
+};
+
+// Асинхронное транскодирование
+struct transcoder_async_ctx {
+  std::string in_path;
+  std::string out_path;
+  int64_t start_moment_in_ms = 0;
+  int64_t end_moment_in_ms = 0;
+  // Приоритет запустившего потока, с которым транскодирование ожидает слота
+  scheduler_priority priority = SCHEDULER_PRIORITY_NORMAL;
+  transcoder_control control;
+  std::thread thread;
+  std::atomic<bool> finished{false};
+  int result = 0;
+};
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_TRANSCODER_TRANSCODER_CONTEXT_HPP_
@@ -5,5 +5,6 @@
 #define TRANSCODER_MAYBE_FILE_NOT_FOUND (-2)
 #define TRANSCODER_UNEXPECTED_ERROR (-3)
 #define TRANSCODER_MAYBE_FILE_ALREADY_EXIST (-4)
+#define TRANSCODER_CANCELLED_ERROR (-5)
 
 #endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_TRANSCODER_TRANSCODER_ERRORS_HPP_
\ No newline at end of file
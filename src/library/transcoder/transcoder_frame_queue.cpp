@@ -0,0 +1,47 @@
+#include "transcoder_frame_queue.hpp"
+#include "../scheduler/scheduler.hpp"
+
+bool transcoder_frame_queue_push(transcoder_frame_queue *queue, AVFrame *frame) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    scheduler_wait(lock, queue->not_full, [queue] { return queue->closed || queue->frames.size() < queue->capacity; });
+
+    if (queue->closed) {
+        return false;
+    }
+
+    queue->frames.push_back(frame);
+    queue->not_empty.notify_one();
+    return true;
+}
+
+bool transcoder_frame_queue_pop(transcoder_frame_queue *queue, AVFrame **frame_ref) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    scheduler_wait(lock, queue->not_empty, [queue] { return queue->finished || !queue->frames.empty(); });
+
+    if (queue->frames.empty()) {
+        return false;
+    }
+
+    *frame_ref = queue->frames.front();
+    queue->frames.pop_front();
+    queue->not_full.notify_one();
+    return true;
+}
+
+void transcoder_frame_queue_finish(transcoder_frame_queue *queue) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->finished = true;
+    queue->not_empty.notify_all();
+}
+
+void transcoder_frame_queue_close(transcoder_frame_queue *queue) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->closed = true;
+
+    for (auto &frame : queue->frames) {
+        av_frame_free(&frame);
+    }
+
+    queue->frames.clear();
+    queue->not_full.notify_all();
+}
@@ -0,0 +1,38 @@
+#ifndef FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_TRANSCODER_TRANSCODER_FRAME_QUEUE_HPP_
+#define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_TRANSCODER_TRANSCODER_FRAME_QUEUE_HPP_
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// Ограниченная очередь фреймов между стадиями конвейера транскодирования
+struct transcoder_frame_queue {
+  std::mutex mutex;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+  std::deque<AVFrame *> frames;
+  std::size_t capacity = 1;
+  // Писатель больше не будет добавлять фреймы
+  bool finished = false;
+  // Читатель больше не будет забирать фреймы
+  bool closed = false;
+};
+
+// Добавляет фрейм, ожидая свободного места. Возвращает false, если очередь закрыта читателем,
+// в этом случае фрейм остается во владении вызывающего.
+bool transcoder_frame_queue_push(transcoder_frame_queue *queue, AVFrame *frame);
+
+// Забирает фрейм, ожидая его появления. Возвращает false, если фреймов больше не будет.
+bool transcoder_frame_queue_pop(transcoder_frame_queue *queue, AVFrame **frame_ref);
+
+// Сообщает читателю, что фреймов больше не будет
+void transcoder_frame_queue_finish(transcoder_frame_queue *queue);
+
+// Закрывает очередь со стороны читателя и освобождает оставшиеся в ней фреймы
+void transcoder_frame_queue_close(transcoder_frame_queue *queue);
+
+#endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_LIBRARY_TRANSCODER_TRANSCODER_FRAME_QUEUE_HPP_
@@ -1,4 +1,5 @@
 #include "../../library/buffer/buffer.hpp"
+#include "../../library/buffer/internal/buffer_context.hpp"
 #include "gtest/gtest.h"
 
 TEST(BufferTest, Allocating) {
@@ -46,4 +47,56 @@ TEST(BufferTest, DeletingFromStart) {
     buffer_delete_from_start(ctx_ref, 128);
     EXPECT_EQ(buffer_get_colums_count(ctx_ref), 0);
     buffer_free(&ctx_ref);
-}
\ No newline at end of file
+}
+
+TEST(BufferTest, InterleavedAppendAndDelete) {
+    void *ctx_ref = nullptr;
+    buffer_allocate(&ctx_ref, 2);
+    uint8_t next_written = 0;
+    uint8_t next_read = 0;
+
+    // Пишем неравными порциями и читаем фреймами, проверяя сохранность порядка данных
+    for (int i = 0; i < 10000; ++i) {
+        std::size_t chunk_size = 700 + (i % 5) * 300;
+        auto pointers = buffer_allocate_new_columns(ctx_ref, chunk_size);
+
+        for (std::size_t j = 0; j < chunk_size; ++j) {
+            pointers[0][j] = next_written;
+            pointers[1][j] = static_cast<uint8_t>(~next_written);
+            next_written++;
+        }
+
+        delete[] pointers;
+
+        while (buffer_get_colums_count(ctx_ref) >= 1024) {
+            EXPECT_EQ(buffer_get_pointer(ctx_ref)[0][0], next_read);
+            EXPECT_EQ(buffer_get_pointer(ctx_ref)[1][1023], static_cast<uint8_t>(~(next_read + 1023)));
+            buffer_delete_from_start(ctx_ref, 1024);
+            next_read = static_cast<uint8_t>(next_read + 1024);
+        }
+    }
+
+    buffer_free(&ctx_ref);
+}
+
+TEST(BufferTest, LongStreamKeepsCapacityBounded) {
+    void *ctx_ref = nullptr;
+    buffer_allocate(&ctx_ref, 2);
+    auto casted_ctx = reinterpret_cast<buffer_ctx *>(ctx_ref);
+    std::size_t frame_bytes = 1024 * 4;
+    std::size_t max_capacity = 0;
+
+    // Примерно три часа стерео при 32 кГц: объем памяти не должен зависеть от длины потока
+    for (int i = 0; i < 340000; ++i) {
+        delete[] buffer_allocate_new_columns(ctx_ref, 4609 - (i % 3) * 1000);
+
+        while (buffer_get_colums_count(ctx_ref) >= frame_bytes) {
+            buffer_delete_from_start(ctx_ref, frame_bytes);
+        }
+
+        max_capacity = std::max(max_capacity, casted_ctx->capacity);
+    }
+
+    EXPECT_LE(max_capacity, 4 * 4609 + 4 * frame_bytes);
+    buffer_free(&ctx_ref);
+}
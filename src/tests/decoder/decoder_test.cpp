@@ -1,5 +1,7 @@
 #include "../../library/decoder/decoder.hpp"
 #include "../../library/decoder/decoder_errors.hpp"
+#include "../../library/decoder/decoder_context.hpp"
+#include "../../library/decoder/decoder_pool.hpp"
 #include "../helpers/resources_helper.hpp"
 
 extern "C" {
@@ -9,6 +11,12 @@ extern "C" {
 #include "gtest/gtest.h"
 #include "../helpers/audio_helper.hpp"
 
+#include <filesystem>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
 // True, если нужно сгенерировать файлы шаблонов
 bool decoder_generate_examples = false;
 
@@ -39,6 +47,18 @@ TEST(DecoderTest, FileNotExists) {
     EXPECT_EQ(ctx_ref, nullptr);
 }
 
+TEST(DecoderTest, InterruptedInputOpening) {
+    void *ctx_ref = nullptr;
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    std::string path = get_test_resource_path("decoder", "test.ogg");
+    decoder_options options;
+    options.interrupt_callback = AVIOInterruptCB{[](void *) { return 1; }, nullptr};
+
+    EXPECT_EQ(decoder_init(&ctx_ref, path.c_str(), 0, 0, streams_types, options),
+              DECODER_INPUT_OPENING_ERROR);
+    EXPECT_EQ(ctx_ref, nullptr);
+}
+
 TEST(DecoderTest, NotAllStreamsFound) {
     void *ctx_ref = nullptr;
     std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_VIDEO};
@@ -76,11 +96,12 @@ void check_decoding(const std::string &in_path,
                     AVSampleFormat sample_format,
                     uint64_t duration,
                     int64_t start,
-                    int64_t end) {
+                    int64_t end,
+                    const decoder_options &options = decoder_options{}) {
     void *ctx_ref = nullptr;
     std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
     std::string path = get_test_resource_path("decoder", in_path);
-    EXPECT_EQ(decoder_init(&ctx_ref, path.c_str(), start, end, streams_types), 0);
+    EXPECT_EQ(decoder_init(&ctx_ref, path.c_str(), start, end, streams_types, options), 0);
     EXPECT_NE(ctx_ref, nullptr);
 
     // Сверяем параметры
@@ -199,4 +220,688 @@ TEST(DecoderTest, WavDecoding) {
                          AV_CH_LAYOUT_STEREO,
                          AVSampleFormat::AV_SAMPLE_FMT_S16,
                          74349219);
-}
\ No newline at end of file
+}
+
+// Проверяет, что пакетное декодирование выдает те же данные, что и декодирование с кэллбэком
+void check_batch_decoding(const std::string &in_path, int64_t start, int64_t end) {
+    void *ctx_ref = nullptr;
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    std::string path = get_test_resource_path("decoder", in_path);
+    ASSERT_EQ(decoder_init(&ctx_ref, path.c_str(), start, end, streams_types), 0);
+
+    AVSampleFormat sample_format = decoder_get_sample_format(ctx_ref, 0);
+    int channels_count = decoder_get_channels_count(ctx_ref, 0);
+    int rows_count = av_sample_fmt_is_planar(sample_format) ? channels_count : 1;
+    int row_bytes_per_sample = av_get_bytes_per_sample(sample_format) * (channels_count / rows_count);
+    int block_samples_count = 3000;
+    int max_frames_count = 8;
+
+    auto block = std::vector<std::vector<uint8_t>>(
+        rows_count, std::vector<uint8_t>(block_samples_count * row_bytes_per_sample));
+    auto block_pointers = std::vector<uint8_t *>(rows_count);
+    auto descriptors = std::vector<decoder_frame_descriptor>(max_frames_count);
+    auto buffer = std::vector<std::vector<uint8_t>>(rows_count);
+
+    for (int i = 0; i < rows_count; ++i) {
+        block_pointers[i] = block[i].data();
+    }
+
+    int result;
+    int64_t last_pts = -1;
+
+    while ((result = decoder_decode_batch(ctx_ref,
+                                          0,
+                                          block_pointers.data(),
+                                          block_samples_count,
+                                          descriptors.data(),
+                                          max_frames_count)) > 0) {
+        int samples_count = 0;
+
+        for (int i = 0; i < result; ++i) {
+            EXPECT_GT(descriptors[i].pts, last_pts);
+            last_pts = descriptors[i].pts;
+            samples_count += descriptors[i].samples_count;
+        }
+
+        EXPECT_LE(samples_count, block_samples_count);
+
+        for (int i = 0; i < rows_count; ++i) {
+            buffer[i].insert(buffer[i].end(),
+                             block[i].begin(),
+                             block[i].begin() + samples_count * row_bytes_per_sample);
+        }
+    }
+
+    EXPECT_EQ(result, DECODER_END_OF_STREAM_ERROR);
+    decoder_free(&ctx_ref);
+
+    std::string example_path = in_path + "_" + std::to_string(start) + "_" + std::to_string(end) + ".pcm";
+    std::vector<std::vector<uint8_t>>
+        example_buffer = read_matrix_from_file("decoder", example_path, true);
+    EXPECT_TRUE(is_audio_matches(buffer, example_buffer, sample_format));
+}
+
+TEST(DecoderTest, BatchDecoding) {
+    check_batch_decoding("test.mp3", 0, 13000);
+    check_batch_decoding("test.ogg", 12000, 13000);
+    check_batch_decoding("test.wav", 0, 13000);
+}
+
+// Декодирует FLAC с указанными настройками потоков, проверяя, с какими потоками открылся кодек
+std::vector<std::vector<uint8_t>> decode_flac(const decoder_options &options,
+                                              int64_t end,
+                                              int expected_threads_count,
+                                              int expected_thread_type) {
+    void *ctx_ref = nullptr;
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    std::string path = get_test_resource_path("decoder", "test.flac");
+    EXPECT_EQ(decoder_init(&ctx_ref, path.c_str(), 0, end, streams_types, options), 0);
+
+    AVCodecContext *context = (*static_cast<decoder_ctx *>(ctx_ref)->stream_contexts)[0]->context;
+    EXPECT_EQ(context->thread_count, expected_threads_count);
+    EXPECT_EQ(context->active_thread_type, expected_thread_type);
+
+    int rows_count = av_sample_fmt_is_planar(decoder_get_sample_format(ctx_ref, 0))
+                     ? decoder_get_channels_count(ctx_ref, 0) : 1;
+    std::vector<std::vector<uint8_t>> buffer(rows_count);
+    int last_result = 0;
+
+    while (last_result >= 0) {
+        last_result = decoder_decode(ctx_ref, [&buffer, rows_count](auto data, size_t len, auto) {
+          for (int i = 0; i < rows_count; i++) {
+              buffer[i].insert(buffer[i].end(), data[i], data[i] + len);
+          }
+
+          return true;
+        });
+    }
+
+    EXPECT_EQ(last_result, DECODER_END_OF_STREAM_ERROR);
+    decoder_free(&ctx_ref);
+    return buffer;
+}
+
+TEST(DecoderTest, ThreadedDecoding) {
+    // В отличие от Vorbis и MP3, декодер FLAC поддерживает многопоточность по фреймам
+    auto single_buffer = decode_flac(decoder_options{}, 0, 1, 0);
+    auto threaded_buffer = decode_flac(decoder_options{DECODER_THREADS_FIXED, 4}, 0, 4, FF_THREAD_FRAME);
+
+    // Две секунды стерео 16 бит на 32 кГц. Задержанные потоками кодека фреймы должны выдаваться в конце.
+    size_t bytes_count = 0;
+
+    for (auto &row : single_buffer) {
+        bytes_count += row.size();
+    }
+
+    EXPECT_EQ(bytes_count, 64000 * 2 * sizeof(int16_t));
+    EXPECT_EQ(threaded_buffer, single_buffer);
+
+    // На коротком фрагменте автоматический выбор оставляет один поток
+    decode_flac(decoder_options{DECODER_THREADS_AUTO, 0}, 1000, 1, 0);
+}
+
+TEST(DecoderTest, ShortClipStopsReadingAfterRangeEnd) {
+    void *ctx_ref = nullptr;
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    std::string path = get_test_resource_path("transcoder", "multiple.ogg");
+    ASSERT_EQ(decoder_init(&ctx_ref, path.c_str(), 0, 1000, streams_types), 0);
+
+    int last_result = 0;
+
+    while (last_result >= 0) {
+        last_result = decoder_decode(ctx_ref, [](auto, auto, auto) { return true; });
+    }
+
+    // Для секундного фрагмента демуксер не должен дочитывать файл до конца
+    int64_t bytes_read = static_cast<decoder_ctx *>(ctx_ref)->format_ctx->pb->bytes_read;
+    EXPECT_EQ(last_result, DECODER_END_OF_STREAM_ERROR);
+    EXPECT_LT(bytes_read, static_cast<int64_t>(std::filesystem::file_size(path) / 4));
+    decoder_free(&ctx_ref);
+}
+
+TEST(DecoderTest, SingleStreamClipStopsReadingAfterRangeEnd) {
+    void *ctx_ref = nullptr;
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    std::string path = get_test_resource_path("transcoder", "multiple.ogg");
+    decoder_options options;
+    options.stream_index = 0;
+    ASSERT_EQ(decoder_init(&ctx_ref, path.c_str(), 0, 1000, streams_types, options), 0);
+
+    int last_result = 0;
+
+    while (last_result >= 0) {
+        last_result = decoder_decode(ctx_ref, [](auto, auto, auto) { return true; });
+    }
+
+    // Остальные потоки не выбраны, поэтому чтение заканчивается вместе с выбранным потоком
+    int64_t bytes_read = static_cast<decoder_ctx *>(ctx_ref)->format_ctx->pb->bytes_read;
+    EXPECT_EQ(last_result, DECODER_END_OF_STREAM_ERROR);
+    EXPECT_LT(bytes_read, static_cast<int64_t>(std::filesystem::file_size(path) / 4));
+    decoder_free(&ctx_ref);
+}
+
+TEST(DecoderTest, DecodingFromMemory) {
+    auto data = read_file_bytes(get_test_resource_path("decoder", "test.ogg"));
+    void *ctx_ref = nullptr;
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    ASSERT_EQ(decoder_init_from_memory(&ctx_ref, data.data(), data.size(), 12000, 13000, streams_types), 0);
+    EXPECT_EQ(decoder_get_sample_rate(ctx_ref, 0), 32000);
+    EXPECT_EQ(decoder_get_duration_in_us(ctx_ref), 74349219);
+
+    auto buffer = std::vector<std::vector<uint8_t>>(2);
+    int last_result = 0;
+
+    while (last_result >= 0) {
+        last_result = decoder_decode(ctx_ref, [&buffer](auto data, size_t len, auto) {
+          for (int i = 0; i < 2; i++) {
+              buffer[i].insert(buffer[i].end(), data[i], data[i] + len);
+          }
+
+          return true;
+        });
+    }
+
+    EXPECT_EQ(last_result, DECODER_END_OF_STREAM_ERROR);
+    decoder_free(&ctx_ref);
+
+    std::vector<std::vector<uint8_t>>
+        example_buffer = read_matrix_from_file("decoder", "test.ogg_12000_13000.pcm", true);
+    EXPECT_TRUE(is_audio_matches(buffer, example_buffer, AVSampleFormat::AV_SAMPLE_FMT_FLTP));
+}
+
+TEST(DecoderTest, MmapInputDecoding) {
+    decoder_options options;
+    options.input_mode = DECODER_INPUT_MMAP;
+
+    check_decoding("test.mp3",
+                   "test.mp3",
+                   32000,
+                   2,
+                   AV_CH_LAYOUT_STEREO,
+                   AVSampleFormat::AV_SAMPLE_FMT_S16P,
+                   74412000,
+                   12000, 13000,
+                   options);
+}
+
+TEST(DecoderTest, MmapInputFileNotExists) {
+    void *ctx_ref = nullptr;
+    decoder_options options;
+    options.input_mode = DECODER_INPUT_MMAP;
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+
+    EXPECT_EQ(decoder_init(&ctx_ref, ".not_exists.mp3", 0, 0, streams_types, options),
+              DECODER_INPUT_OPENING_ERROR);
+    EXPECT_EQ(ctx_ref, nullptr);
+}
+
+TEST(DecoderTest, UnsupportedCodec) {
+    void *ctx_ref = nullptr;
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    std::string path = get_test_resource_path("decoder", "adpcm.wav");
+
+    // Декодер ADPCM не входит в сборку FFmpeg
+    EXPECT_EQ(decoder_init(&ctx_ref, path.c_str(), 0, 0, streams_types), DECODER_NOT_ALL_CODECS_OPENED_ERROR);
+    EXPECT_EQ(ctx_ref, nullptr);
+}
+
+TEST(DecoderTest, PooledDecodersReuseCodecs) {
+    void *pool_ref = nullptr;
+    decoder_pool_init(&pool_ref, 4);
+
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    std::string path = get_test_resource_path("decoder", "test.ogg");
+    std::vector<std::vector<uint8_t>>
+        example_buffer = read_matrix_from_file("decoder", "test.ogg_12000_13000.pcm", true);
+
+    // Каждый повторно выданный декодер должен декодировать так же, как только что открытый
+    for (int i = 0; i < 16; ++i) {
+        void *ctx_ref = nullptr;
+        ASSERT_EQ(decoder_pool_acquire(pool_ref, &ctx_ref, path.c_str(), 12000, 13000, streams_types), 0);
+
+        auto buffer = std::vector<std::vector<uint8_t>>(2);
+        int last_result = 0;
+
+        while (last_result >= 0) {
+            last_result = decoder_decode(ctx_ref, [&buffer](auto data, size_t len, auto) {
+              for (int j = 0; j < 2; j++) {
+                  buffer[j].insert(buffer[j].end(), data[j], data[j] + len);
+              }
+
+              return true;
+            });
+        }
+
+        EXPECT_EQ(last_result, DECODER_END_OF_STREAM_ERROR);
+        EXPECT_TRUE(is_audio_matches(buffer, example_buffer, AVSampleFormat::AV_SAMPLE_FMT_FLTP));
+        decoder_free(&ctx_ref);
+        EXPECT_EQ(ctx_ref, nullptr);
+    }
+
+    int64_t reused_codecs_count;
+    int64_t opened_codecs_count;
+    decoder_pool_get_stats(pool_ref, &reused_codecs_count, &opened_codecs_count);
+    EXPECT_EQ(opened_codecs_count, 1);
+    EXPECT_EQ(reused_codecs_count, 15);
+
+    decoder_pool_free(&pool_ref);
+    EXPECT_EQ(pool_ref, nullptr);
+}
+
+TEST(DecoderTest, PooledCodecsMatchThreading) {
+    void *pool_ref = nullptr;
+    decoder_pool_init(&pool_ref, 4);
+
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    std::string path = get_test_resource_path("decoder", "test.flac");
+    decoder_options threaded_options{DECODER_THREADS_FIXED, 4};
+
+    // Кодек, открытый в один поток, не должен выдаваться декодеру, запросившему четыре потока
+    for (const decoder_options &options : {decoder_options{}, threaded_options, threaded_options}) {
+        void *ctx_ref = nullptr;
+        ASSERT_EQ(decoder_pool_acquire(pool_ref, &ctx_ref, path.c_str(), 0, 0, streams_types, options), 0);
+
+        AVCodecContext *context = (*static_cast<decoder_ctx *>(ctx_ref)->stream_contexts)[0]->context;
+        EXPECT_EQ(context->thread_count, options.threads_count);
+        decoder_free(&ctx_ref);
+    }
+
+    int64_t reused_codecs_count;
+    int64_t opened_codecs_count;
+    decoder_pool_get_stats(pool_ref, &reused_codecs_count, &opened_codecs_count);
+    EXPECT_EQ(opened_codecs_count, 2);
+    EXPECT_EQ(reused_codecs_count, 1);
+
+    decoder_pool_free(&pool_ref);
+}
+
+TEST(DecoderTest, ParallelStreamsDecoding) {
+    void *ctx_ref = nullptr;
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    std::string path = get_test_resource_path("decoder", "test.ogg");
+    ASSERT_EQ(decoder_init(&ctx_ref, path.c_str(), 12000, 13000, streams_types), 0);
+
+    auto buffer = std::vector<std::vector<uint8_t>>(2);
+    int result = decoder_decode_streams(ctx_ref, [&buffer](size_t stream_index, auto data, size_t len, auto) {
+      EXPECT_EQ(stream_index, 0);
+
+      for (int i = 0; i < 2; i++) {
+          buffer[i].insert(buffer[i].end(), data[i], data[i] + len);
+      }
+
+      return true;
+    });
+
+    EXPECT_EQ(result, 0);
+    decoder_free(&ctx_ref);
+
+    std::vector<std::vector<uint8_t>>
+        example_buffer = read_matrix_from_file("decoder", "test.ogg_12000_13000.pcm", true);
+    EXPECT_TRUE(is_audio_matches(buffer, example_buffer, AVSampleFormat::AV_SAMPLE_FMT_FLTP));
+}
+
+TEST(DecoderTest, ParallelDecodingOfMultipleStreams) {
+    void *ctx_ref = nullptr;
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    std::string path = get_test_resource_path("transcoder", "multiple.ogg");
+    ASSERT_EQ(decoder_init(&ctx_ref, path.c_str(), 0, 2000, streams_types), 0);
+    ASSERT_EQ(decoder_get_streams_count(ctx_ref), 2);
+
+    // Обработчик вызывается из разных потоков, поэтому каждый поток пишет только в свой счетчик
+    std::vector<size_t> bytes_counts(2, 0);
+    int result = decoder_decode_streams(ctx_ref, [&bytes_counts](size_t stream_index, auto, size_t len, auto) {
+      bytes_counts[stream_index] += len;
+      return true;
+    }, 2);
+
+    EXPECT_EQ(result, 0);
+    EXPECT_GT(bytes_counts[0], 0);
+    EXPECT_GT(bytes_counts[1], 0);
+    decoder_free(&ctx_ref);
+}
+
+TEST(DecoderTest, SingleSelectedStreamDecoding) {
+    void *ctx_ref = nullptr;
+    decoder_options options;
+    options.stream_index = 1;
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    std::string path = get_test_resource_path("transcoder", "multiple.ogg");
+    ASSERT_EQ(decoder_init(&ctx_ref, path.c_str(), 0, 2000, streams_types, options), 0);
+    EXPECT_FALSE(decoder_is_stream_selected(ctx_ref, 0));
+    EXPECT_TRUE(decoder_is_stream_selected(ctx_ref, 1));
+
+    int result = decoder_decode_streams(ctx_ref, [](size_t stream_index, auto, auto, auto) {
+      EXPECT_EQ(stream_index, 1);
+      return true;
+    });
+
+    EXPECT_EQ(result, 0);
+    decoder_free(&ctx_ref);
+
+    options.stream_index = 2;
+    EXPECT_EQ(decoder_init(&ctx_ref, path.c_str(), 0, 2000, streams_types, options),
+              DECODER_NOT_ALL_CODECS_FOUND_ERROR);
+}
+
+TEST(DecoderTest, ReadAheadDecoding) {
+    decoder_options options;
+    options.read_ahead_packets = 4;
+
+    check_decoding("test.ogg",
+                   "test.ogg",
+                   32000,
+                   2,
+                   AV_CH_LAYOUT_STEREO,
+                   AVSampleFormat::AV_SAMPLE_FMT_FLTP,
+                   74349219,
+                   0, 0,
+                   options);
+    check_decoding("test.mp3",
+                   "test.mp3",
+                   32000,
+                   2,
+                   AV_CH_LAYOUT_STEREO,
+                   AVSampleFormat::AV_SAMPLE_FMT_S16P,
+                   74412000,
+                   12000, 13000,
+                   options);
+}
+
+TEST(DecoderTest, ReadAheadStats) {
+    void *ctx_ref = nullptr;
+    decoder_read_ahead_stats stats{};
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    std::string path = get_test_resource_path("decoder", "test.wav");
+
+    ASSERT_EQ(decoder_init(&ctx_ref, path.c_str(), 0, 0, streams_types), 0);
+    EXPECT_EQ(decoder_get_read_ahead_stats(ctx_ref, &stats), DECODER_UNEXPECTED_ERROR);
+    decoder_free(&ctx_ref);
+
+    decoder_options options;
+    options.read_ahead_packets = 8;
+    ASSERT_EQ(decoder_init(&ctx_ref, path.c_str(), 0, 0, streams_types, options), 0);
+
+    int last_result = 0;
+    int64_t packets_count = 0;
+
+    while (last_result >= 0) {
+        last_result = decoder_decode(ctx_ref, [](auto, auto, auto) { return true; });
+        packets_count++;
+    }
+
+    EXPECT_EQ(last_result, DECODER_END_OF_STREAM_ERROR);
+    ASSERT_EQ(decoder_get_read_ahead_stats(ctx_ref, &stats), 0);
+    EXPECT_EQ(stats.capacity, 8);
+    EXPECT_EQ(stats.depth, 0);
+    EXPECT_EQ(stats.packets_count, packets_count - 1);
+    EXPECT_GT(stats.max_depth, 0);
+    EXPECT_LE(stats.max_depth, 8);
+    decoder_free(&ctx_ref);
+}
+
+TEST(DecoderTest, FusedConversionToInterleavedFloat) {
+    void *ctx_ref = nullptr;
+    decoder_options options;
+    options.output_sample_format = AV_SAMPLE_FMT_FLT;
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    std::string path = get_test_resource_path("decoder", "test.ogg");
+    ASSERT_EQ(decoder_init(&ctx_ref, path.c_str(), 12000, 13000, streams_types, options), 0);
+    EXPECT_EQ(decoder_get_sample_format(ctx_ref, 0), AV_SAMPLE_FMT_FLT);
+    EXPECT_EQ(decoder_get_sample_rate(ctx_ref, 0), 32000);
+    EXPECT_EQ(decoder_get_channels_count(ctx_ref, 0), 2);
+
+    // Раскладываем чередующиеся семплы по каналам, чтобы сравнить с образцом в планарном формате
+    auto buffer = std::vector<std::vector<uint8_t>>(2);
+    int last_result = 0;
+
+    while (last_result >= 0) {
+        last_result = decoder_decode(ctx_ref, [&buffer](auto data, size_t len, auto) {
+          for (size_t i = 0; i < len; i += sizeof(float)) {
+              auto &channel = buffer[(i / sizeof(float)) % 2];
+              channel.insert(channel.end(), data[0] + i, data[0] + i + sizeof(float));
+          }
+
+          return true;
+        });
+    }
+
+    EXPECT_EQ(last_result, DECODER_END_OF_STREAM_ERROR);
+    decoder_free(&ctx_ref);
+
+    std::vector<std::vector<uint8_t>>
+        example_buffer = read_matrix_from_file("decoder", "test.ogg_12000_13000.pcm", true);
+    EXPECT_TRUE(is_audio_matches(buffer, example_buffer, AVSampleFormat::AV_SAMPLE_FMT_FLTP));
+}
+
+TEST(DecoderTest, FusedConversionToMonoFloatForAnalysis) {
+    void *ctx_ref = nullptr;
+    decoder_options options;
+    options.output_sample_format = AV_SAMPLE_FMT_FLT;
+    options.output_sample_rate = 16000;
+    options.output_channel_layout = AV_CH_LAYOUT_MONO;
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    std::string path = get_test_resource_path("decoder", "test.mp3");
+    ASSERT_EQ(decoder_init(&ctx_ref, path.c_str(), 12000, 14000, streams_types, options), 0);
+    EXPECT_EQ(decoder_get_sample_format(ctx_ref, 0), AV_SAMPLE_FMT_FLT);
+    EXPECT_EQ(decoder_get_sample_rate(ctx_ref, 0), 16000);
+    EXPECT_EQ(decoder_get_channels_count(ctx_ref, 0), 1);
+    EXPECT_EQ(decoder_get_channel_layout(ctx_ref, 0), AV_CH_LAYOUT_MONO);
+
+    size_t samples_count = 0;
+    int last_result = 0;
+
+    while (last_result >= 0) {
+        last_result = decoder_decode(ctx_ref, [&samples_count](auto, size_t len, auto) {
+          samples_count += len / sizeof(float);
+          return true;
+        });
+    }
+
+    EXPECT_EQ(last_result, DECODER_END_OF_STREAM_ERROR);
+    decoder_free(&ctx_ref);
+
+    // Две секунды на 16 кГц с точностью до фрейма MP3 и задержки ресемплера
+    EXPECT_NEAR(static_cast<double>(samples_count), 32000.0, 1152.0);
+}
+
+// Считает семплы всех фреймов записи в планарном float при выдаче с указанной частотой дискретизации.
+// 0 - без преобразования.
+size_t count_decoded_samples(const std::string &path, int output_sample_rate, bool refcounted) {
+    void *ctx_ref = nullptr;
+    decoder_options options;
+    options.output_sample_rate = output_sample_rate;
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    EXPECT_EQ(decoder_init(&ctx_ref, path.c_str(), 0, 0, streams_types, options), 0);
+
+    size_t samples_count = 0;
+    int last_result = 0;
+
+    while (last_result >= 0) {
+        last_result = refcounted
+                      ? decoder_decode_frames(ctx_ref, [&samples_count](AVFrame *frame) {
+                          samples_count += frame->nb_samples;
+                          decoder_frame_free(&frame);
+                          return true;
+                        })
+                      : decoder_decode(ctx_ref, [&samples_count](auto, size_t len, auto) {
+                          samples_count += len / sizeof(float);
+                          return true;
+                        });
+    }
+
+    EXPECT_EQ(last_result, DECODER_END_OF_STREAM_ERROR);
+    decoder_free(&ctx_ref);
+    return samples_count;
+}
+
+TEST(DecoderTest, ResamplerTailIsDrainedAtEnd) {
+    std::string path = get_test_resource_path("decoder", "test.ogg");
+    size_t input_samples_count = count_decoded_samples(path, 0, false);
+
+    // Задержанные ресемплером семплы выдаются в конце, поэтому при 32 -> 48 кГц длина растет ровно в полтора раза
+    for (bool refcounted : {false, true}) {
+        size_t samples_count = count_decoded_samples(path, 48000, refcounted);
+        EXPECT_NEAR(static_cast<double>(samples_count), static_cast<double>(input_samples_count) * 1.5, 2.0);
+    }
+}
+
+TEST(DecoderTest, RefcountedFramesOutliveDecoding) {
+    void *ctx_ref = nullptr;
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    std::string path = get_test_resource_path("decoder", "test.ogg");
+    ASSERT_EQ(decoder_init(&ctx_ref, path.c_str(), 12000, 13000, streams_types), 0);
+
+    // Фреймы только складываются, их данные читаются уже после освобождения декодера
+    std::vector<AVFrame *> frames;
+    int last_result = 0;
+
+    while (last_result >= 0) {
+        last_result = decoder_decode_frames(ctx_ref, [&frames](AVFrame *frame) {
+          frames.push_back(frame);
+          return true;
+        });
+    }
+
+    EXPECT_EQ(last_result, DECODER_END_OF_STREAM_ERROR);
+    decoder_free(&ctx_ref);
+    ASSERT_FALSE(frames.empty());
+
+    auto buffer = std::vector<std::vector<uint8_t>>(2);
+    int64_t prev_pts = -1;
+
+    for (auto &frame : frames) {
+        EXPECT_GT(frame->pts, prev_pts);
+        prev_pts = frame->pts;
+
+        for (int i = 0; i < 2; i++) {
+            buffer[i].insert(buffer[i].end(), frame->data[i], frame->data[i] + frame->nb_samples * sizeof(float));
+        }
+
+        decoder_frame_free(&frame);
+    }
+
+    std::vector<std::vector<uint8_t>>
+        example_buffer = read_matrix_from_file("decoder", "test.ogg_12000_13000.pcm", true);
+    EXPECT_TRUE(is_audio_matches(buffer, example_buffer, AVSampleFormat::AV_SAMPLE_FMT_FLTP));
+}
+
+TEST(DecoderTest, RefcountedFramesMovedToAnotherThread) {
+    void *ctx_ref = nullptr;
+    decoder_options options;
+    options.output_sample_format = AV_SAMPLE_FMT_S16;
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    std::string path = get_test_resource_path("decoder", "test.mp3");
+    ASSERT_EQ(decoder_init(&ctx_ref, path.c_str(), 12000, 13000, streams_types, options), 0);
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<AVFrame *> queue;
+    bool finished = false;
+    size_t received_samples_count = 0;
+
+    // Потребитель получает фреймы из другого потока, не копируя семплы
+    std::thread consumer([&] {
+      while (true) {
+          std::unique_lock<std::mutex> lock(mutex);
+          condition.wait(lock, [&] { return finished || !queue.empty(); });
+
+          if (queue.empty()) {
+              return;
+          }
+
+          AVFrame *frame = queue.front();
+          queue.pop_front();
+          lock.unlock();
+
+          EXPECT_EQ(frame->format, AV_SAMPLE_FMT_S16);
+          received_samples_count += frame->nb_samples;
+          decoder_frame_free(&frame);
+      }
+    });
+
+    size_t sent_samples_count = 0;
+    int last_result = 0;
+
+    while (last_result >= 0) {
+        last_result = decoder_decode_frames(ctx_ref, [&](AVFrame *frame) {
+          AVFrame *copy = decoder_frame_ref(frame);
+          EXPECT_EQ(copy->data[0], frame->data[0]);
+          sent_samples_count += frame->nb_samples;
+          decoder_frame_free(&copy);
+
+          std::lock_guard<std::mutex> lock(mutex);
+          queue.push_back(frame);
+          condition.notify_one();
+          return true;
+        });
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+        condition.notify_one();
+    }
+
+    consumer.join();
+    decoder_free(&ctx_ref);
+
+    EXPECT_EQ(last_result, DECODER_END_OF_STREAM_ERROR);
+    EXPECT_GT(sent_samples_count, 0);
+    EXPECT_EQ(received_samples_count, sent_samples_count);
+}
+
+// Декодирует фрагмент, запоминая первую плоскость каждого фрейма по его pts
+std::map<int64_t, std::vector<uint8_t>> decode_frames_by_pts(const std::string &path,
+                                                             int64_t start,
+                                                             int64_t end,
+                                                             const decoder_options &options) {
+    void *ctx_ref = nullptr;
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    std::map<int64_t, std::vector<uint8_t>> frames;
+    EXPECT_EQ(decoder_init(&ctx_ref, path.c_str(), start, end, streams_types, options), 0);
+
+    int last_result = 0;
+
+    while (last_result >= 0) {
+        last_result = decoder_decode(ctx_ref, [&frames](auto data, size_t len, int64_t pts) {
+          frames[pts] = std::vector<uint8_t>(data[0], data[0] + len);
+          return true;
+        });
+    }
+
+    EXPECT_EQ(last_result, DECODER_END_OF_STREAM_ERROR);
+    decoder_free(&ctx_ref);
+    return frames;
+}
+
+TEST(DecoderTest, SkippingPrerollKeepsDecodedFramesIntact) {
+    decoder_options skip_options;
+    skip_options.skip_preroll_packets = true;
+
+    for (const auto &name : {"test.mp3", "test.ogg"}) {
+        std::string path = get_test_resource_path("decoder", name);
+
+        for (int64_t start : {1000, 12000, 30000, 60000}) {
+            auto frames = decode_frames_by_pts(path, start, start + 500, decoder_options{});
+            auto skipped_frames = decode_frames_by_pts(path, start, start + 500, skip_options);
+            ASSERT_FALSE(skipped_frames.empty());
+
+            // Фреймы до начала нарезки не выдаются
+            EXPECT_GT(skipped_frames.rbegin()->first, start * 1000);
+
+            // Пре-ролла достаточно, чтобы общие с полным декодированием фреймы совпадали побайтово
+            size_t common_frames_count = 0;
+
+            for (const auto &[pts, data] : skipped_frames) {
+                EXPECT_GE(pts + 200000, start * 1000);
+
+                if (frames.contains(pts)) {
+                    EXPECT_EQ(frames[pts], data);
+                    common_frames_count++;
+                }
+            }
+
+            EXPECT_GT(common_frames_count, 0);
+        }
+    }
+}
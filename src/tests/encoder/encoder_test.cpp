@@ -4,6 +4,7 @@
 #include "../helpers/resources_helper.hpp"
 #include "../../library/encoder/encoder.hpp"
 #include "../../library/encoder/encoder_errors.hpp"
+#include "../../library/encoder/encoder_context.hpp"
 #include "../helpers/audio_helper.hpp"
 
 extern "C" {
@@ -160,4 +161,83 @@ TEST(EncoderTest, AacEncoding) {
     // Сначала прочитаем правильный файл
     std::string example_path = get_file_path("encoder", "test.aac", true);
     EXPECT_TRUE(is_audio_files_matches(example_path, path));
-}
\ No newline at end of file
+}
+
+TEST(EncoderTest, AacEncodingThroughWritablePlanes) {
+    void *context = nullptr;
+    auto cfg = new encoder_stream_audio_codec_cfg{32000, 2, AV_CH_LAYOUT_STEREO,
+                                                  AVSampleFormat::AV_SAMPLE_FMT_FLTP};
+    std::string path = "test-planes-res.aac";
+    std::filesystem::remove(path);
+
+    std::map<int, encoder_stream_cfg> streams{{0, encoder_stream_cfg{AV_CODEC_ID_AAC, cfg}}};
+    encoder_init(&context, path.c_str(), streams);
+
+    // Пишем порциями, не кратными размеру фрейма, чтобы задействовать перенос хвоста
+    std::vector<std::vector<uint8_t>>
+        buffer = read_matrix_from_file("encoder", "test.ogg.pcm", false);
+    int bytes_per_sample = encoder_get_bytes_per_sample_count(context, 0);
+    size_t full_length = buffer[0].size();
+    size_t encoded_count = 0;
+    int last_encode_result = 0;
+
+    while (encoded_count < full_length && last_encode_result >= 0) {
+        size_t chunk_size = std::min<size_t>(1152 * bytes_per_sample, full_length - encoded_count);
+        int samples_count = (int) chunk_size / bytes_per_sample;
+        uint8_t **planes = encoder_get_writable_planes(context, 0, samples_count);
+        ASSERT_NE(planes, nullptr);
+
+        for (size_t j = 0; j < buffer.size(); j++) {
+            memcpy(planes[j], buffer[j].data() + encoded_count, chunk_size);
+        }
+
+        last_encode_result = encoder_commit_written_samples(context, 0, samples_count);
+        encoded_count += chunk_size;
+    }
+
+    EXPECT_EQ(last_encode_result, 0);
+    EXPECT_EQ(encoder_finish_encode(context), 0);
+
+    delete cfg;
+    encoder_free(&context);
+    EXPECT_TRUE(std::filesystem::exists(path));
+
+    std::string example_path = get_file_path("encoder", "test.aac", true);
+    EXPECT_TRUE(is_audio_files_matches(example_path, path));
+}
+
+TEST(EncoderTest, FramesBuffersAreReusedFromPool) {
+    void *context = nullptr;
+    auto cfg = new encoder_stream_audio_codec_cfg{32000, 2, AV_CH_LAYOUT_STEREO,
+                                                  AVSampleFormat::AV_SAMPLE_FMT_FLTP};
+    std::string path = "test-pool-res.aac";
+    std::filesystem::remove(path);
+
+    std::map<int, encoder_stream_cfg> streams{{0, encoder_stream_cfg{AV_CODEC_ID_AAC, cfg}}};
+    EXPECT_EQ(encoder_init(&context, path.c_str(), streams), 0);
+
+    auto stream_ctx = (*static_cast<encoder_ctx *>(context)->streams_map)[0];
+    size_t frame_bytes = encoder_get_samples_count_per_frame(context, 0)
+        * encoder_get_bytes_per_sample_count(context, 0);
+    std::vector<std::vector<uint8_t>> planes(2, std::vector<uint8_t>(frame_bytes, 0));
+    uint8_t *data[2] = {planes[0].data(), planes[1].data()};
+
+    // Прогреваем пул, после чего новых выделений памяти под фреймы быть не должно
+    for (int i = 0; i < 16; ++i) {
+        EXPECT_EQ(encoder_encode(context, 0, data, frame_bytes), 0);
+    }
+
+    int64_t warm_allocations_count = stream_ctx->frames_pool_allocations_count;
+    EXPECT_GT(warm_allocations_count, 0);
+
+    for (int i = 0; i < 512; ++i) {
+        EXPECT_EQ(encoder_encode(context, 0, data, frame_bytes), 0);
+    }
+
+    EXPECT_EQ(stream_ctx->frames_pool_allocations_count, warm_allocations_count);
+    EXPECT_EQ(encoder_finish_encode(context), 0);
+
+    delete cfg;
+    encoder_free(&context);
+    std::filesystem::remove(path);
+}
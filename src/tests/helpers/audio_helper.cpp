@@ -1,5 +1,6 @@
 #include <vector>
 #include <bit>
+#include <cmath>
 
 extern "C" {
 #include <libavformat/avformat.h>
@@ -193,4 +194,65 @@ bool is_audio_files_matches(const std::string &test_file_path,
     }
 
     return true;
-}
\ No newline at end of file
+}
+
+double get_audio_files_snr(const std::string &test_file_path, const std::string &valid_file_path) {
+    AVSampleFormat sample_format;
+    auto test_buffer = decode_audio(test_file_path, &sample_format);
+    auto valid_buffer = decode_audio(valid_file_path, &sample_format);
+    double signal = 0;
+    double noise = 0;
+
+    for (size_t i = 0; i < std::min(test_buffer.size(), valid_buffer.size()); ++i) {
+        size_t samples_count = std::min(test_buffer[i].size(), valid_buffer[i].size()) / sizeof(float);
+        auto test_samples = reinterpret_cast<const float *>(test_buffer[i].data());
+        auto valid_samples = reinterpret_cast<const float *>(valid_buffer[i].data());
+
+        for (size_t j = 0; j < samples_count; ++j) {
+            signal += valid_samples[j] * valid_samples[j];
+            noise += (test_samples[j] - valid_samples[j]) * (test_samples[j] - valid_samples[j]);
+        }
+    }
+
+    return noise == 0 ? INFINITY : 10 * std::log10(signal / noise);
+}
+
+bool is_audio_files_continuous_at(const std::string &test_file_path,
+                                  const std::string &valid_file_path,
+                                  const std::vector<int64_t> &positions,
+                                  int64_t window) {
+    AVSampleFormat sample_format;
+    auto test_buffer = decode_audio(test_file_path, &sample_format);
+    auto valid_buffer = decode_audio(valid_file_path, &sample_format);
+
+    if (test_buffer.size() != valid_buffer.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < test_buffer.size(); ++i) {
+        if (test_buffer[i].size() != valid_buffer[i].size()) {
+            return false;
+        }
+
+        auto samples_count = static_cast<int64_t>(test_buffer[i].size() / sizeof(float));
+        auto test_samples = reinterpret_cast<const float *>(test_buffer[i].data());
+        auto valid_samples = reinterpret_cast<const float *>(valid_buffer[i].data());
+
+        for (int64_t position : positions) {
+            float test_jump = 0;
+            float valid_jump = 0;
+
+            for (int64_t j = std::max<int64_t>(position - window, 1); j < std::min(position + window, samples_count); ++j) {
+                test_jump = std::max(test_jump, std::abs(test_samples[j] - test_samples[j - 1]));
+                valid_jump = std::max(valid_jump, std::abs(valid_samples[j] - valid_samples[j - 1]));
+            }
+
+            // Щелчок на стыке дает перепад, которого нет в эталоне
+            if (test_jump > 2 * valid_jump + 1e-3) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
@@ -2,6 +2,8 @@
 #define FLUTTER_MEDIA_TOOLS_NATIVE_SRC_TESTS_HELPERS_AUDIO_HELPER_HPP_
 
 #include <string>
+#include <vector>
+#include <cstdint>
 
 // Проверяет схожесть двух аудио-файлов в PCM
 bool is_audio_matches(std::vector<std::vector<uint8_t>> &test,
@@ -11,4 +13,14 @@ bool is_audio_matches(std::vector<std::vector<uint8_t>> &test,
 // Проверяет схожесть двух .wav или .pcm файлов
 bool is_audio_files_matches(const std::string &test_file_path, const std::string &valid_file_path);
 
+// Считает отношение сигнал/шум в дБ между двумя аудио-файлами одинаковой длины с семплами в float
+double get_audio_files_snr(const std::string &test_file_path, const std::string &valid_file_path);
+
+// Проверяет, что файлы совпадают по количеству семплов, а в окрестностях указанных позиций
+// перепады между соседними семплами тестового файла не больше чем вдвое превышают перепады эталонного
+bool is_audio_files_continuous_at(const std::string &test_file_path,
+                                  const std::string &valid_file_path,
+                                  const std::vector<int64_t> &positions,
+                                  int64_t window);
+
 #endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_TESTS_HELPERS_AUDIO_HELPER_HPP_
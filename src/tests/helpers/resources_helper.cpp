@@ -111,4 +111,9 @@ bool write_matrix_to_file(const std::string &path,
 
     file.close();
     return true;
-}
\ No newline at end of file
+}
+
+std::vector<uint8_t> read_file_bytes(const std::string &path) {
+    std::ifstream input(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+}
@@ -34,4 +34,7 @@ std::vector<std::vector<uint8_t>> read_matrix_from_file(const std::string &main_
 bool write_matrix_to_file(const std::string &path, std::vector<std::vector<uint8_t>> &data,
                           bool write_length);
 
+// Читает файл целиком
+std::vector<uint8_t> read_file_bytes(const std::string &path);
+
 #endif //FLUTTER_MEDIA_TOOLS_NATIVE_SRC_TESTS_HELPERS_RESOURCES_HELPER_HPP_
\ No newline at end of file
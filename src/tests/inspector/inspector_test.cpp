@@ -25,4 +25,13 @@ TEST(InspectorTest, Mp3Duration) {
 TEST(InspectorTest, AacDuration) {
     std::string path = get_test_resource_path("inspector", "test.aac");
     EXPECT_EQ(inspector_get_audio_duration_in_us(path.c_str()), 74368000);
-}
\ No newline at end of file
+}
+
+TEST(InspectorTest, OggDurationFromMemory) {
+    auto data = read_file_bytes(get_test_resource_path("inspector", "test.ogg"));
+    EXPECT_EQ(inspector_get_audio_duration_in_us_from_memory(data.data(), data.size()), 74349219);
+}
+
+TEST(InspectorTest, EmptyMemory) {
+    EXPECT_EQ(inspector_get_audio_duration_in_us_from_memory(nullptr, 0), INSPECTOR_MAYBE_FILE_NOT_FOUND);
+}
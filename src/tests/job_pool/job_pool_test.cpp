@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "../../library/job_pool/job_pool.hpp"
+#include "../../library/job_pool/job_pool_errors.hpp"
+
+TEST(JobPoolTest, InvalidWorkersCount) {
+    void *ctx = nullptr;
+    EXPECT_EQ(job_pool_init(&ctx, -1), JOB_POOL_INVALID_WORKERS_COUNT_ERROR);
+    EXPECT_EQ(ctx, nullptr);
+}
+
+TEST(JobPoolTest, WorkersCountSelectedByCores) {
+    void *ctx;
+    ASSERT_EQ(job_pool_init(&ctx, 0), 0);
+
+    job_pool_stats stats{};
+    job_pool_get_stats(ctx, &stats);
+    EXPECT_GE(stats.workers_count, 1);
+    job_pool_free(&ctx);
+    EXPECT_EQ(ctx, nullptr);
+}
+
+TEST(JobPoolTest, AllJobsExecuted) {
+    void *ctx;
+    ASSERT_EQ(job_pool_init(&ctx, 4), 0);
+
+    std::atomic<int> sum{0};
+
+    for (int i = 1; i <= 100; ++i) {
+        EXPECT_EQ(job_pool_submit(ctx, [&sum, i] { sum += i; }), 0);
+    }
+
+    job_pool_wait(ctx);
+    EXPECT_EQ(sum, 5050);
+
+    job_pool_stats stats{};
+    job_pool_get_stats(ctx, &stats);
+    EXPECT_EQ(stats.executed_jobs_count, 100);
+    job_pool_free(&ctx);
+}
+
+TEST(JobPoolTest, IdleWorkersStealLongQueues) {
+    void *ctx;
+    ASSERT_EQ(job_pool_init(&ctx, 2), 0);
+
+    // Первый поток занят длинной задачей, поэтому короткие задачи из его очереди забирает второй
+    EXPECT_EQ(job_pool_submit(ctx, [] { std::this_thread::sleep_for(std::chrono::milliseconds(200)); }), 0);
+
+    std::atomic<int> executed{0};
+
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(job_pool_submit(ctx, [&executed] { executed++; }), 0);
+    }
+
+    job_pool_wait(ctx);
+    EXPECT_EQ(executed, 10);
+
+    job_pool_stats stats{};
+    job_pool_get_stats(ctx, &stats);
+    EXPECT_GT(stats.steals_count, 0);
+    job_pool_free(&ctx);
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include "../helpers/resources_helper.hpp"
+#include "../../library/probe_cache/probe_cache.hpp"
+#include "../../library/probe_cache/probe_cache_context.hpp"
+#include "../../library/decoder/decoder.hpp"
+#include "../../library/inspector/inspector.hpp"
+
+// Открывает и сразу закрывает декодер
+void open_decoder(const std::string &path) {
+    void *ctx_ref = nullptr;
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    ASSERT_EQ(decoder_init(&ctx_ref, path.c_str(), 0, 0, streams_types), 0);
+    decoder_free(&ctx_ref);
+}
+
+TEST(ProbeCacheTest, DisabledByDefault) {
+    probe_cache_clear();
+    std::string path = get_test_resource_path("inspector", "test.ogg");
+    int64_t hits_count;
+    int64_t misses_count;
+
+    open_decoder(path);
+    open_decoder(path);
+    probe_cache_get_stats(&hits_count, &misses_count);
+    EXPECT_EQ(hits_count, 0);
+    EXPECT_EQ(misses_count, 0);
+}
+
+TEST(ProbeCacheTest, ReopenHitsCache) {
+    probe_cache_clear();
+    probe_cache_set_capacity(32);
+    std::string path = get_test_resource_path("inspector", "test.ogg");
+    int64_t hits_count;
+    int64_t misses_count;
+
+    EXPECT_EQ(inspector_get_audio_duration_in_us(path.c_str()), 74349219);
+    probe_cache_get_stats(&hits_count, &misses_count);
+    EXPECT_EQ(hits_count, 0);
+    EXPECT_EQ(misses_count, 1);
+
+    // Длительность и параметры потока должны восстановиться из кэша без анализа файла
+    EXPECT_EQ(inspector_get_audio_duration_in_us(path.c_str()), 74349219);
+    probe_cache_get_stats(&hits_count, &misses_count);
+    EXPECT_EQ(hits_count, 1);
+    EXPECT_EQ(misses_count, 1);
+
+    void *ctx_ref = nullptr;
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    ASSERT_EQ(decoder_init(&ctx_ref, path.c_str(), 0, 0, streams_types), 0);
+    EXPECT_EQ(decoder_get_sample_rate(ctx_ref, 0), 32000);
+    EXPECT_EQ(decoder_get_channels_count(ctx_ref, 0), 2);
+    EXPECT_EQ(decoder_get_sample_format(ctx_ref, 0), AVSampleFormat::AV_SAMPLE_FMT_FLTP);
+    decoder_free(&ctx_ref);
+
+    probe_cache_set_capacity(PROBE_CACHE_DEFAULT_CAPACITY);
+    probe_cache_clear();
+}
+
+TEST(ProbeCacheTest, LeastRecentlyUsedEntryIsEvicted) {
+    probe_cache_clear();
+    probe_cache_set_capacity(1);
+    std::string ogg_path = get_test_resource_path("inspector", "test.ogg");
+    std::string mp3_path = get_test_resource_path("inspector", "test.mp3");
+    int64_t hits_count;
+    int64_t misses_count;
+
+    open_decoder(ogg_path);
+    open_decoder(mp3_path);
+    open_decoder(ogg_path);
+    open_decoder(ogg_path);
+
+    probe_cache_get_stats(&hits_count, &misses_count);
+    EXPECT_EQ(hits_count, 1);
+    EXPECT_EQ(misses_count, 3);
+
+    probe_cache_set_capacity(0);
+    open_decoder(ogg_path);
+    probe_cache_get_stats(&hits_count, &misses_count);
+    EXPECT_EQ(hits_count, 1);
+    EXPECT_EQ(misses_count, 3);
+
+    probe_cache_set_capacity(PROBE_CACHE_DEFAULT_CAPACITY);
+    probe_cache_clear();
+}
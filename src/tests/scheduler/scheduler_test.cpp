@@ -0,0 +1,247 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../../library/scheduler/scheduler.hpp"
+#include "../../library/scheduler/scheduler_errors.hpp"
+
+// Записывает порядок получения слотов потоками
+struct scheduler_test_order {
+  std::mutex mutex;
+  std::vector<std::string> names;
+
+  void add(const std::string &name) {
+      std::lock_guard<std::mutex> lock(mutex);
+      names.push_back(name);
+  }
+};
+
+// Ожидает, пока в очереди приоритета окажется указанное количество задач
+void wait_for_waiters(scheduler_priority priority, int64_t waiting_count) {
+    scheduler_priority_stats stats{};
+
+    do {
+        std::this_thread::yield();
+        scheduler_get_stats(priority, &stats);
+    } while (stats.waiting_count != waiting_count);
+}
+
+// Прерывает ожидание слота, когда выставлен флаг
+int interrupt_by_flag(void *opaque) {
+    return static_cast<std::atomic<bool> *>(opaque)->load() ? 1 : 0;
+}
+
+TEST(SchedulerTest, HigherPriorityServedFirst) {
+    scheduler_set_max_workers(1);
+    scheduler_reset_stats();
+    scheduler_acquire();
+
+    scheduler_test_order order;
+    auto run_task = [&order](scheduler_priority priority, const std::string &name) {
+      scheduler_set_thread_priority(priority);
+      scheduler_slot_guard slot;
+      order.add(name);
+    };
+
+    std::thread batch_thread(run_task, SCHEDULER_PRIORITY_BATCH, "batch");
+    wait_for_waiters(SCHEDULER_PRIORITY_BATCH, 1);
+    std::thread interactive_thread(run_task, SCHEDULER_PRIORITY_INTERACTIVE, "interactive");
+    wait_for_waiters(SCHEDULER_PRIORITY_INTERACTIVE, 1);
+
+    // Фоновая задача пришла раньше, но слот достается интерактивной
+    scheduler_release();
+    batch_thread.join();
+    interactive_thread.join();
+
+    ASSERT_EQ(order.names.size(), 2);
+    EXPECT_EQ(order.names[0], "interactive");
+    EXPECT_EQ(order.names[1], "batch");
+
+    scheduler_priority_stats stats{};
+    scheduler_get_stats(SCHEDULER_PRIORITY_BATCH, &stats);
+    EXPECT_EQ(stats.acquisitions_count, 1);
+    EXPECT_EQ(stats.waiting_count, 0);
+    EXPECT_GT(stats.total_wait_time_us, 0);
+    EXPECT_EQ(stats.max_wait_time_us, stats.total_wait_time_us);
+
+    scheduler_get_stats(SCHEDULER_PRIORITY_INTERACTIVE, &stats);
+    EXPECT_EQ(stats.acquisitions_count, 1);
+
+    scheduler_set_max_workers(0);
+}
+
+TEST(SchedulerTest, SamePriorityServedInArrivalOrder) {
+    scheduler_set_max_workers(1);
+    scheduler_acquire();
+
+    scheduler_test_order order;
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < 3; ++i) {
+        threads.emplace_back([&order, i] {
+          scheduler_slot_guard slot;
+          order.add(std::to_string(i));
+        });
+        wait_for_waiters(SCHEDULER_PRIORITY_NORMAL, i + 1);
+    }
+
+    scheduler_release();
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(order.names, std::vector<std::string>({"0", "1", "2"}));
+    scheduler_set_max_workers(0);
+}
+
+TEST(SchedulerTest, BatchTaskYieldsToInteractive) {
+    scheduler_set_max_workers(1);
+    scheduler_reset_stats();
+    scheduler_set_thread_priority(SCHEDULER_PRIORITY_BATCH);
+    scheduler_acquire();
+
+    // Без ожидающих задач уступать слот некому
+    EXPECT_EQ(scheduler_yield(), 0);
+
+    scheduler_test_order order;
+    std::thread interactive_thread([&order] {
+      scheduler_set_thread_priority(SCHEDULER_PRIORITY_INTERACTIVE);
+      scheduler_slot_guard slot;
+      order.add("interactive");
+    });
+
+    // На границе фрейма длинная задача отдает слот и получает его после интерактивной
+    wait_for_waiters(SCHEDULER_PRIORITY_INTERACTIVE, 1);
+    EXPECT_EQ(scheduler_yield(), 1);
+    order.add("batch");
+
+    scheduler_release();
+    interactive_thread.join();
+    scheduler_set_thread_priority(SCHEDULER_PRIORITY_NORMAL);
+
+    EXPECT_EQ(order.names, std::vector<std::string>({"interactive", "batch"}));
+
+    scheduler_priority_stats stats{};
+    scheduler_get_stats(SCHEDULER_PRIORITY_BATCH, &stats);
+    EXPECT_EQ(stats.yields_count, 1);
+    EXPECT_EQ(stats.acquisitions_count, 2);
+
+    scheduler_set_max_workers(0);
+}
+
+TEST(SchedulerTest, NestedAcquireUsesSameSlot) {
+    scheduler_set_max_workers(1);
+    scheduler_reset_stats();
+
+    // Вложенный вход в библиотеку не должен ждать слота, который уже занят этим потоком
+    scheduler_acquire();
+    scheduler_acquire();
+    scheduler_release();
+
+    std::atomic<bool> acquired{false};
+    std::thread thread([&acquired] {
+      scheduler_slot_guard slot;
+      acquired = true;
+    });
+
+    wait_for_waiters(SCHEDULER_PRIORITY_NORMAL, 1);
+    EXPECT_FALSE(acquired);
+
+    scheduler_release();
+    thread.join();
+    EXPECT_TRUE(acquired);
+
+    scheduler_priority_stats stats{};
+    scheduler_get_stats(SCHEDULER_PRIORITY_NORMAL, &stats);
+    EXPECT_EQ(stats.acquisitions_count, 2);
+
+    scheduler_set_max_workers(0);
+}
+
+TEST(SchedulerTest, InterruptedWaiterLeavesQueue) {
+    scheduler_set_max_workers(1);
+    scheduler_acquire();
+
+    std::atomic<bool> interrupted{false};
+    int interrupted_result = 0;
+    std::thread interrupted_thread([&interrupted, &interrupted_result] {
+      interrupted_result = scheduler_acquire_interruptible(interrupt_by_flag, &interrupted);
+    });
+    wait_for_waiters(SCHEDULER_PRIORITY_NORMAL, 1);
+
+    std::atomic<bool> acquired{false};
+    std::thread next_thread([&acquired] {
+      scheduler_slot_guard slot;
+      acquired = true;
+    });
+    wait_for_waiters(SCHEDULER_PRIORITY_NORMAL, 2);
+
+    // Прерванная задача выходит из очереди, не дожидаясь освобождения слота
+    interrupted = true;
+    scheduler_wake_waiters();
+    interrupted_thread.join();
+    EXPECT_EQ(interrupted_result, SCHEDULER_INTERRUPTED_ERROR);
+    EXPECT_FALSE(acquired);
+
+    // Следующая за ней задача получает слот, как только он освободится
+    scheduler_release();
+    next_thread.join();
+    EXPECT_TRUE(acquired);
+
+    scheduler_set_max_workers(0);
+}
+
+TEST(SchedulerTest, SuspendedSlotIsGivenToOthers) {
+    scheduler_set_max_workers(1);
+    scheduler_acquire();
+    scheduler_suspend();
+
+    // Пока поток ждет ввода-вывода, его слот может занять другая задача
+    std::thread thread([] {
+      scheduler_slot_guard slot;
+    });
+    thread.join();
+
+    scheduler_resume();
+    EXPECT_EQ(scheduler_yield(), 0);
+    scheduler_release();
+
+    scheduler_set_max_workers(0);
+}
+
+TEST(SchedulerTest, WorkersTakeSlotsOfTheirOwn) {
+    scheduler_set_max_workers(1);
+    scheduler_set_thread_priority(SCHEDULER_PRIORITY_NORMAL);
+    scheduler_reset_stats();
+    scheduler_slot_guard slot;
+
+    std::mutex mutex;
+    std::condition_variable done_changed;
+    bool done = false;
+
+    // Рабочий поток ждет слота, который задача отдает, пока ждет его результата
+    std::thread worker([&] {
+      scheduler_slot_guard worker_slot(scheduler_get_thread_priority());
+      std::lock_guard<std::mutex> lock(mutex);
+      done = true;
+      done_changed.notify_all();
+    });
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        scheduler_wait(lock, done_changed, [&done] { return done; });
+    }
+
+    scheduler_join(worker);
+
+    // Задача, рабочий поток и два возврата слота задаче после ожидания
+    scheduler_priority_stats stats{};
+    scheduler_get_stats(SCHEDULER_PRIORITY_NORMAL, &stats);
+    EXPECT_EQ(stats.acquisitions_count, 4);
+
+    scheduler_set_max_workers(0);
+}
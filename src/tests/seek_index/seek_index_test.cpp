@@ -0,0 +1,94 @@
+#include <filesystem>
+#include <gtest/gtest.h>
+#include "../helpers/resources_helper.hpp"
+#include "../../library/seek_index/seek_index.hpp"
+#include "../../library/seek_index/seek_index_errors.hpp"
+#include "../../library/decoder/decoder.hpp"
+
+TEST(SeekIndexTest, FileNotExists) {
+    EXPECT_EQ(seek_index_build(".not_exists.mp3", "not_exists.seekidx"), SEEK_INDEX_INPUT_OPENING_ERROR);
+    EXPECT_FALSE(std::filesystem::exists("not_exists.seekidx"));
+}
+
+TEST(SeekIndexTest, IndexNotExists) {
+    void *ctx_ref = nullptr;
+    std::string path = get_test_resource_path("decoder", "test.mp3");
+    EXPECT_EQ(seek_index_open(&ctx_ref, path.c_str(), ".not_exists.seekidx"), SEEK_INDEX_READING_ERROR);
+    EXPECT_EQ(ctx_ref, nullptr);
+}
+
+TEST(SeekIndexTest, BuildAndFind) {
+    std::string path = get_test_resource_path("decoder", "test.mp3");
+    std::string index_path = "test.mp3.seekidx";
+    ASSERT_EQ(seek_index_build(path.c_str(), index_path.c_str()), 0);
+
+    void *ctx_ref = nullptr;
+    ASSERT_EQ(seek_index_open(&ctx_ref, path.c_str(), index_path.c_str()), 0);
+
+    int64_t pts;
+    int64_t pos;
+    int64_t prev_pos = -1;
+
+    // Найденный пакет должен начинаться не позже запрошенного момента и не раньше, чем на фрейм
+    for (int64_t moment = 1000000; moment < 70000000; moment += 7000000) {
+        EXPECT_EQ(seek_index_find(ctx_ref, moment, &pts, &pos), 0);
+        EXPECT_LE(pts, moment);
+        EXPECT_GT(pts, moment - 100000);
+        EXPECT_GT(pos, prev_pos);
+        prev_pos = pos;
+    }
+
+    EXPECT_EQ(seek_index_find(ctx_ref, -1, &pts, &pos), SEEK_INDEX_ENTRY_NOT_FOUND_ERROR);
+    seek_index_free(&ctx_ref);
+    EXPECT_EQ(ctx_ref, nullptr);
+    std::filesystem::remove(index_path);
+}
+
+TEST(SeekIndexTest, StaleIndexIsRejected) {
+    std::string source_path = get_test_resource_path("decoder", "test.mp3");
+    std::string path = "test-stale.mp3";
+    std::string index_path = "test-stale.mp3.seekidx";
+    std::filesystem::copy_file(source_path, path, std::filesystem::copy_options::overwrite_existing);
+    ASSERT_EQ(seek_index_build(path.c_str(), index_path.c_str()), 0);
+
+    auto mtime = std::filesystem::last_write_time(path);
+    std::filesystem::last_write_time(path, mtime + std::chrono::seconds(1));
+
+    void *ctx_ref = nullptr;
+    EXPECT_EQ(seek_index_open(&ctx_ref, path.c_str(), index_path.c_str()), SEEK_INDEX_STALE_ERROR);
+    EXPECT_EQ(ctx_ref, nullptr);
+
+    std::filesystem::remove(index_path);
+    std::filesystem::remove(path);
+}
+
+TEST(SeekIndexTest, DecoderStartsFromIndexedPacket) {
+    std::string path = get_test_resource_path("decoder", "test.mp3");
+    std::string index_path = "test-decoder.mp3.seekidx";
+    ASSERT_EQ(seek_index_build(path.c_str(), index_path.c_str()), 0);
+
+    void *ctx_ref = nullptr;
+    decoder_options options;
+    options.seek_index_path = index_path.c_str();
+    std::unordered_set<AVMediaType> streams_types{AVMediaType::AVMEDIA_TYPE_AUDIO};
+    ASSERT_EQ(decoder_init(&ctx_ref, path.c_str(), 12000, 13000, streams_types, options), 0);
+
+    int64_t first_pts = AV_NOPTS_VALUE;
+    int last_result = 0;
+
+    while (last_result >= 0 && first_pts == AV_NOPTS_VALUE) {
+        last_result = decoder_decode(ctx_ref, [&first_pts](auto, auto, int64_t pts) {
+          if (first_pts == AV_NOPTS_VALUE) {
+              first_pts = pts;
+          }
+
+          return true;
+        });
+    }
+
+    EXPECT_LE(first_pts, 12000000);
+    EXPECT_GT(first_pts, 12000000 - 100000);
+
+    decoder_free(&ctx_ref);
+    std::filesystem::remove(index_path);
+}
@@ -1,8 +1,15 @@
 #include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unistd.h>
 #include <gtest/gtest.h>
 #include "../helpers/resources_helper.hpp"
 #include "../../library/transcoder/transcoder.hpp"
 #include "../../library/transcoder/transcoder_errors.hpp"
+#include "../../library/scheduler/scheduler.hpp"
 #include "../helpers/audio_helper.hpp"
 
 // Включает режим генерации образцов
@@ -82,4 +89,438 @@ TEST(TranscoderTest, TranscodeMp3) {
 
 TEST(TranscoderTest, TranscodeWav) {
     check_all_variants_of_transcoding_to_aac("test.wav", "test_wav");
-}
\ No newline at end of file
+}
+
+TEST(TranscoderTest, TranscodeMp3FromMemory) {
+    auto data = read_file_bytes(get_test_resource_path("transcoder", "test.mp3"));
+    std::string output_path = "test_mp3_memory_0_12000.aac";
+    std::string valid_path = get_file_path("transcoder", "test_mp3_transcoder_0_12000.aac", true);
+
+    std::remove(output_path.c_str());
+    EXPECT_EQ(transcoder_do_audio_from_memory(data.data(), data.size(), output_path.c_str(), 0, 12000), 0);
+    EXPECT_TRUE(is_audio_files_matches(output_path, valid_path));
+    std::remove(output_path.c_str());
+}
+
+TEST(TranscoderTest, TranscodeEachStreamInParallel) {
+    std::string input_path = get_test_resource_path("transcoder", "multiple.ogg");
+    std::vector<std::string> output_paths{"multiple_stream_0.aac", "multiple_stream_1.aac"};
+    const char *out_paths[] = {output_paths[0].c_str(), output_paths[1].c_str()};
+
+    for (auto &path : output_paths) {
+        std::remove(path.c_str());
+    }
+
+    EXPECT_EQ(transcoder_do_audio_streams(input_path.c_str(), out_paths, 2, 0, 3000), 0);
+
+    // Выход выбранного потока должен совпадать с соответствующим выходом параллельного транскодирования
+    for (int i = 0; i < 2; ++i) {
+        std::string single_path = "multiple_single_" + std::to_string(i) + ".aac";
+        std::remove(single_path.c_str());
+
+        EXPECT_EQ(transcoder_do_audio_stream(input_path.c_str(), single_path.c_str(), i, 0, 3000), 0);
+        EXPECT_TRUE(is_audio_files_matches(single_path, output_paths[i]));
+        std::remove(single_path.c_str());
+        std::remove(output_paths[i].c_str());
+    }
+}
+
+TEST(TranscoderTest, TranscodeStreamsWithWrongOutputsCount) {
+    std::string input_path = get_test_resource_path("transcoder", "multiple.ogg");
+    const char *out_paths[] = {"multiple_wrong_0.aac"};
+
+    EXPECT_EQ(transcoder_do_audio_streams(input_path.c_str(), out_paths, 1, 0, 0),
+              TRANSCODER_UNSUPPORTED_INPUT_FORMAT);
+    EXPECT_FALSE(std::filesystem::exists(out_paths[0]));
+    EXPECT_EQ(transcoder_do_audio_stream(input_path.c_str(), out_paths[0], 5, 0, 0),
+              TRANSCODER_UNSUPPORTED_INPUT_FORMAT);
+}
+
+// Длина сегмента параллельного кодирования в семплах test.ogg: 10 секунд при 32 кГц, выровненные по фреймам AAC
+#define TRANSCODER_TEST_SEGMENT_LENGTH 320512
+
+// Задержка энкодера AAC в семплах, с которой стыки сегментов оказываются в декодированном выходе
+#define TRANSCODER_TEST_ENCODER_DELAY 1024
+
+// Проверяет, что параллельное кодирование сегментами совпадает с последовательным транскодированием
+// по количеству семплов и не дает щелчков на стыках сегментов
+void check_parallel_transcoding_to_aac(int64_t start_moment_in_ms, int64_t end_moment_in_ms) {
+    std::string input_path = get_test_resource_path("transcoder", "test.ogg");
+    std::string suffix = std::to_string(start_moment_in_ms) + "_" + std::to_string(end_moment_in_ms) + ".aac";
+    std::string output_path = "test_ogg_parallel_" + suffix;
+    std::string serial_path = "test_ogg_serial_" + suffix;
+
+    std::remove(output_path.c_str());
+    std::remove(serial_path.c_str());
+    EXPECT_EQ(transcoder_do_audio(input_path.c_str(), serial_path.c_str(), start_moment_in_ms, end_moment_in_ms), 0);
+    EXPECT_EQ(transcoder_do_audio_parallel(input_path.c_str(),
+                                           output_path.c_str(),
+                                           start_moment_in_ms,
+                                           end_moment_in_ms,
+                                           4), 0);
+
+    std::vector<int64_t> joins;
+
+    for (int64_t position = TRANSCODER_TEST_SEGMENT_LENGTH; position < 80 * 32000;
+         position += TRANSCODER_TEST_SEGMENT_LENGTH) {
+        joins.push_back(position + TRANSCODER_TEST_ENCODER_DELAY);
+    }
+
+    EXPECT_TRUE(is_audio_files_continuous_at(output_path, serial_path, joins, 2 * TRANSCODER_TEST_ENCODER_DELAY));
+    EXPECT_GT(get_audio_files_snr(output_path, serial_path), 10.0);
+    std::remove(output_path.c_str());
+    std::remove(serial_path.c_str());
+}
+
+TEST(TranscoderTest, TranscodeOggInParallelSegments) {
+    check_parallel_transcoding_to_aac(0, 0);
+    check_parallel_transcoding_to_aac(13000, 0);
+}
+
+TEST(TranscoderTest, TranscodeShortOggInParallelFallsBackToSerial) {
+    check_parallel_transcoding_to_aac(12000, 13000);
+}
+
+// Накапливает данные, переданные в обработчик записи
+struct transcoder_test_sink {
+  std::vector<uint8_t> data;
+  size_t max_chunk_size = 0;
+  size_t chunks_limit = SIZE_MAX;
+  size_t chunks_count = 0;
+};
+
+bool write_to_test_sink(void *opaque, const uint8_t *data, size_t size) {
+    auto sink = static_cast<transcoder_test_sink *>(opaque);
+
+    if (sink->chunks_count++ >= sink->chunks_limit) {
+        return false;
+    }
+
+    sink->data.insert(sink->data.end(), data, data + size);
+    sink->max_chunk_size = std::max(sink->max_chunk_size, size);
+    return true;
+}
+
+TEST(TranscoderTest, TranscodeToMemoryMatchesFileOutput) {
+    std::string input_path = get_test_resource_path("transcoder", "test.ogg");
+    std::string output_path = "test_ogg_file_output_0_12000.aac";
+
+    std::remove(output_path.c_str());
+    EXPECT_EQ(transcoder_do_audio(input_path.c_str(), output_path.c_str(), 0, 12000), 0);
+
+    uint8_t *data = nullptr;
+    size_t size = 0;
+    EXPECT_EQ(transcoder_do_audio_to_memory(input_path.c_str(), &data, &size, 0, 12000, 0), 0);
+    EXPECT_EQ(std::vector<uint8_t>(data, data + size), read_file_bytes(output_path));
+
+    transcoder_free_output_data(&data);
+    EXPECT_EQ(data, nullptr);
+    std::remove(output_path.c_str());
+}
+
+TEST(TranscoderTest, TranscodeToCallbackWithSmallBuffer) {
+    std::string input_path = get_test_resource_path("transcoder", "test.ogg");
+    std::string output_path = "test_ogg_callback_output_0_12000.aac";
+
+    std::remove(output_path.c_str());
+    EXPECT_EQ(transcoder_do_audio(input_path.c_str(), output_path.c_str(), 0, 12000), 0);
+
+    transcoder_test_sink sink;
+    EXPECT_EQ(transcoder_do_audio_to_callback(input_path.c_str(), write_to_test_sink, &sink, 0, 12000, 512), 0);
+    EXPECT_EQ(sink.data, read_file_bytes(output_path));
+    // Данные передаются порциями не больше буффера записи
+    EXPECT_LE(sink.max_chunk_size, 512);
+    EXPECT_GT(sink.chunks_count, 1);
+    std::remove(output_path.c_str());
+}
+
+TEST(TranscoderTest, TranscodeToCallbackStopsOnRefusal) {
+    std::string input_path = get_test_resource_path("transcoder", "test.ogg");
+    transcoder_test_sink sink;
+    sink.chunks_limit = 2;
+
+    EXPECT_EQ(transcoder_do_audio_to_callback(input_path.c_str(), write_to_test_sink, &sink, 0, 12000, 4096),
+              TRANSCODER_UNEXPECTED_ERROR);
+}
+
+TEST(TranscoderTest, AacInputIsCopiedWithoutReencoding) {
+    std::string input_path = get_file_path("transcoder", "test_ogg_transcoder_0_0.aac", true);
+    std::string output_path = "test_aac_passthrough_0_0.aac";
+
+    std::remove(output_path.c_str());
+    EXPECT_EQ(transcoder_do_audio(input_path.c_str(), output_path.c_str(), 0, 0), 0);
+    EXPECT_EQ(read_file_bytes(output_path), read_file_bytes(input_path));
+    std::remove(output_path.c_str());
+}
+
+TEST(TranscoderTest, AacInputIsReencodedWhenCut) {
+    std::string input_path = get_file_path("transcoder", "test_ogg_transcoder_0_0.aac", true);
+    std::string output_path = "test_aac_passthrough_12000_13000.aac";
+
+    std::remove(output_path.c_str());
+    EXPECT_EQ(transcoder_do_audio(input_path.c_str(), output_path.c_str(), 12000, 13000), 0);
+
+    // Фреймы нарезки перекодируются, а не копируются подряд из входа
+    auto input_bytes = read_file_bytes(input_path);
+    auto output_bytes = read_file_bytes(output_path);
+    EXPECT_FALSE(output_bytes.empty());
+    EXPECT_LT(output_bytes.size(), input_bytes.size());
+    EXPECT_EQ(std::search(input_bytes.begin(), input_bytes.end(), output_bytes.begin(), output_bytes.end()),
+              input_bytes.end());
+    std::remove(output_path.c_str());
+}
+
+// Проверяет, что конвейерное транскодирование выдает тот же файл, что и последовательное
+void check_pipelined_transcoding(const std::string &input_file, int queue_capacity) {
+    std::string input_path = get_test_resource_path("transcoder", input_file);
+    std::string serial_path = input_file + "_serial.aac";
+    std::string pipelined_path = input_file + "_pipelined.aac";
+    transcoder_pipeline_stats stats{};
+
+    std::remove(serial_path.c_str());
+    std::remove(pipelined_path.c_str());
+    EXPECT_EQ(transcoder_do_audio(input_path.c_str(), serial_path.c_str(), 0, 12000), 0);
+    EXPECT_EQ(transcoder_do_audio_pipelined(input_path.c_str(), pipelined_path.c_str(), 0, 12000, queue_capacity, &stats),
+              0);
+    EXPECT_EQ(read_file_bytes(pipelined_path), read_file_bytes(serial_path));
+
+    // Каждый декодированный фрейм проходит через все стадии
+    EXPECT_GT(stats.decoding.frames_count, 0);
+    EXPECT_EQ(stats.resampling.frames_count, stats.decoding.frames_count);
+    EXPECT_EQ(stats.encoding.frames_count, stats.resampling.frames_count);
+
+    for (auto stage : {stats.decoding, stats.resampling, stats.encoding}) {
+        EXPECT_GE(stage.busy_time_us, 0);
+        EXPECT_GE(stage.idle_time_us, 0);
+    }
+
+    std::remove(serial_path.c_str());
+    std::remove(pipelined_path.c_str());
+}
+
+TEST(TranscoderTest, PipelinedTranscodingMatchesSerial) {
+    check_pipelined_transcoding("test.ogg", 0);
+    check_pipelined_transcoding("test.mp3", 0);
+    check_pipelined_transcoding("test.wav", 0);
+}
+
+TEST(TranscoderTest, PipelinedTranscodingWithSingleFrameQueues) {
+    check_pipelined_transcoding("test.mp3", 1);
+}
+
+TEST(TranscoderTest, ThreadedTranscodingWithSingleSchedulerSlot) {
+    // Рабочие потоки ждут своих слотов, а ожидающие друг друга потоки свои слоты отдают
+    scheduler_set_max_workers(1);
+    check_pipelined_transcoding("test.mp3", 1);
+    check_parallel_transcoding_to_aac(0, 0);
+    scheduler_set_max_workers(0);
+}
+
+// Проверяет пакетное транскодирование с указанным количеством рабочих потоков
+void check_batch_transcoding(int workers_count) {
+    std::vector<std::string> inputs{"test.ogg", "test.mp3", "test.wav"};
+    std::vector<std::pair<int64_t, int64_t>> ranges{{0, 12000}, {12000, 13000}};
+    std::vector<std::string> input_paths;
+    std::vector<std::string> output_paths;
+    std::vector<std::string> valid_paths;
+
+    for (auto &input : inputs) {
+        for (auto &range : ranges) {
+            std::string name = input.substr(0, input.find('.')) + "_" + input.substr(input.find('.') + 1);
+            std::string suffix = std::to_string(range.first) + "_" + std::to_string(range.second) + ".aac";
+            input_paths.push_back(get_test_resource_path("transcoder", input));
+            output_paths.push_back(name + "_batch_" + std::to_string(workers_count) + "_" + suffix);
+            valid_paths.push_back(get_file_path("transcoder", name + "_transcoder_" + suffix, true));
+        }
+    }
+
+    // Несуществующий вход не должен мешать остальным задачам
+    input_paths.push_back(get_test_resource_path("transcoder", "test.iformat"));
+    output_paths.push_back("batch_not_exists.aac");
+
+    std::vector<transcoder_job> jobs;
+
+    for (size_t i = 0; i < input_paths.size(); ++i) {
+        auto &range = i < valid_paths.size() ? ranges[i % ranges.size()] : ranges[0];
+        std::remove(output_paths[i].c_str());
+        jobs.push_back(transcoder_job{input_paths[i].c_str(), output_paths[i].c_str(), range.first, range.second});
+    }
+
+    std::vector<int> results(jobs.size(), 1);
+    transcoder_batch_report report{};
+    EXPECT_EQ(transcoder_do_audio_batch(jobs.data(), jobs.size(), results.data(), workers_count, &report), 0);
+
+    for (size_t i = 0; i < valid_paths.size(); ++i) {
+        EXPECT_EQ(results[i], 0);
+        EXPECT_TRUE(is_audio_files_matches(output_paths[i], valid_paths[i]));
+        std::remove(output_paths[i].c_str());
+    }
+
+    EXPECT_EQ(results.back(), TRANSCODER_MAYBE_FILE_NOT_FOUND);
+    EXPECT_EQ(report.workers_count, workers_count);
+    EXPECT_EQ(report.jobs_count, static_cast<int64_t>(jobs.size()));
+    EXPECT_EQ(report.failed_jobs_count, 1);
+    EXPECT_GT(report.wall_time_us, 0);
+    EXPECT_GT(report.jobs_per_second, 0);
+}
+
+TEST(TranscoderTest, BatchTranscodingOnSingleWorker) {
+    check_batch_transcoding(1);
+}
+
+TEST(TranscoderTest, BatchTranscodingOnSeveralWorkers) {
+    check_batch_transcoding(4);
+}
+
+TEST(TranscoderTest, AsyncTranscodingWithProgress) {
+    std::string input_path = get_test_resource_path("transcoder", "test.ogg");
+    std::string output_path = "test_ogg_async_0_12000.aac";
+    std::string valid_path = get_file_path("transcoder", "test_ogg_transcoder_0_12000.aac", true);
+    void *ctx;
+
+    std::remove(output_path.c_str());
+    ASSERT_EQ(transcoder_async_start(&ctx, input_path.c_str(), output_path.c_str(), 0, 12000), 0);
+
+    transcoder_progress progress{};
+    int64_t prev_decoded_us = 0;
+
+    while (transcoder_async_poll(ctx, &progress) == 0) {
+        EXPECT_GE(progress.decoded_us, prev_decoded_us);
+        prev_decoded_us = progress.decoded_us;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    EXPECT_EQ(progress.duration_us, 12000000);
+    EXPECT_GT(progress.decoded_us, progress.duration_us * 9 / 10);
+    EXPECT_EQ(transcoder_async_join(&ctx), 0);
+    EXPECT_EQ(ctx, nullptr);
+    EXPECT_TRUE(is_audio_files_matches(output_path, valid_path));
+    std::remove(output_path.c_str());
+}
+
+TEST(TranscoderTest, AsyncTranscodingCancellation) {
+    std::string input_path = get_test_resource_path("transcoder", "test.ogg");
+    std::string output_path = "test_ogg_async_cancelled.aac";
+    void *ctx;
+
+    std::remove(output_path.c_str());
+    ASSERT_EQ(transcoder_async_start(&ctx, input_path.c_str(), output_path.c_str(), 0, 0), 0);
+    transcoder_async_cancel(ctx);
+
+    EXPECT_EQ(transcoder_async_join(&ctx), TRANSCODER_CANCELLED_ERROR);
+    EXPECT_FALSE(std::filesystem::exists(output_path));
+}
+
+TEST(TranscoderTest, AsyncTranscodingCancelledWhileQueued) {
+    std::string input_path = get_test_resource_path("transcoder", "test.ogg");
+    std::string output_path = "test_ogg_async_queued.aac";
+    void *ctx;
+
+    // Единственный слот планировщика занят, поэтому транскодирование ждет в очереди
+    scheduler_set_max_workers(1);
+    scheduler_acquire();
+
+    std::remove(output_path.c_str());
+    ASSERT_EQ(transcoder_async_start(&ctx, input_path.c_str(), output_path.c_str(), 0, 0), 0);
+
+    scheduler_priority_stats stats{};
+
+    do {
+        std::this_thread::yield();
+        scheduler_get_stats(SCHEDULER_PRIORITY_NORMAL, &stats);
+    } while (stats.waiting_count == 0);
+
+    // Отмена завершает ожидание, не дожидаясь освобождения слота
+    transcoder_async_cancel(ctx);
+    EXPECT_EQ(transcoder_async_join(&ctx), TRANSCODER_CANCELLED_ERROR);
+    EXPECT_FALSE(std::filesystem::exists(output_path));
+
+    scheduler_release();
+    scheduler_set_max_workers(0);
+}
+
+TEST(TranscoderTest, AsyncTranscodingFileNotExists) {
+    std::string input_path = get_test_resource_path("transcoder", "test.iformat");
+    void *ctx;
+
+    ASSERT_EQ(transcoder_async_start(&ctx, input_path.c_str(), "test-async.aac", 0, 0), 0);
+    EXPECT_EQ(transcoder_async_join(&ctx), TRANSCODER_MAYBE_FILE_NOT_FOUND);
+}
+
+TEST(TranscoderTest, TranscodeBetweenPipes) {
+    auto input_bytes = read_file_bytes(get_test_resource_path("transcoder", "test.ogg"));
+    std::string output_path = "test_ogg_pipe_0_0.aac";
+    std::string valid_path = get_file_path("transcoder", "test_ogg_transcoder_0_0.aac", true);
+    int in_pipe[2];
+    int out_pipe[2];
+    ASSERT_EQ(pipe(in_pipe), 0);
+    ASSERT_EQ(pipe(out_pipe), 0);
+
+    std::mutex mutex;
+    std::condition_variable first_byte_received;
+    bool has_first_byte = false;
+    bool first_byte_before_input_end = false;
+    auto started_at = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration first_byte_latency{};
+
+    // Вторая половина входа пишется только после появления первых байтов выхода
+    std::thread writer([&] {
+      size_t half = input_bytes.size() / 2;
+      EXPECT_EQ(write(in_pipe[1], input_bytes.data(), half), static_cast<ssize_t>(half));
+
+      {
+          std::unique_lock<std::mutex> lock(mutex);
+          first_byte_received.wait_for(lock, std::chrono::seconds(10), [&] { return has_first_byte; });
+          first_byte_before_input_end = has_first_byte;
+      }
+
+      size_t rest = input_bytes.size() - half;
+      EXPECT_EQ(write(in_pipe[1], input_bytes.data() + half, rest), static_cast<ssize_t>(rest));
+      close(in_pipe[1]);
+    });
+
+    std::vector<uint8_t> output_bytes;
+    std::thread reader([&] {
+      uint8_t buffer[4096];
+      ssize_t count;
+
+      while ((count = read(out_pipe[0], buffer, sizeof(buffer))) > 0) {
+          if (output_bytes.empty()) {
+              std::lock_guard<std::mutex> lock(mutex);
+              has_first_byte = true;
+              first_byte_latency = std::chrono::steady_clock::now() - started_at;
+              first_byte_received.notify_all();
+          }
+
+          output_bytes.insert(output_bytes.end(), buffer, buffer + count);
+      }
+    });
+
+    EXPECT_EQ(transcoder_do_audio_fd(in_pipe[0], out_pipe[1], 0, 0, 4096), 0);
+    close(out_pipe[1]);
+    reader.join();
+    writer.join();
+    close(in_pipe[0]);
+    close(out_pipe[0]);
+
+    // Выход начинает выдаваться до того, как вход записан целиком
+    EXPECT_TRUE(first_byte_before_input_end);
+    EXPECT_LT(first_byte_latency, std::chrono::seconds(10));
+
+    FILE *output_file = fopen(output_path.c_str(), "wb");
+    ASSERT_NE(output_file, nullptr);
+    fwrite(output_bytes.data(), 1, output_bytes.size(), output_file);
+    fclose(output_file);
+
+    EXPECT_TRUE(is_audio_files_matches(output_path, valid_path));
+    std::remove(output_path.c_str());
+}
+
+TEST(TranscoderTest, TranscodeFromInvalidDescriptor) {
+    int out_pipe[2];
+    ASSERT_EQ(pipe(out_pipe), 0);
+
+    EXPECT_EQ(transcoder_do_audio_fd(-1, out_pipe[1], 0, 0, 0), TRANSCODER_MAYBE_FILE_NOT_FOUND);
+    close(out_pipe[0]);
+    close(out_pipe[1]);
+}